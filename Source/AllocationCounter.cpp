@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.cpp
+
+  ==============================================================================
+*/
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local juce::uint64 threadAllocationCount = 0;
+    std::atomic<juce::uint64> numViolations{ 0 };
+}
+
+juce::uint64 AllocationCounter::getThreadAllocationCount() noexcept
+{
+    return threadAllocationCount;
+}
+
+juce::uint64 AllocationCounter::getNumViolations() noexcept
+{
+    return numViolations.load();
+}
+
+void AllocationCounter::resetViolations() noexcept
+{
+    numViolations.store(0);
+}
+
+void AllocationCounter::reportViolation() noexcept
+{
+    ++numViolations;
+}
+
+#if MARS_COUNT_ALLOCATIONS
+//==============================================================================
+// Counting replacements for the global allocator. Not every standard library
+// forwards the aligned and nothrow variants to the plain form, so each one is
+// replaced here.
+namespace
+{
+    void* countedAllocation(std::size_t size)
+    {
+        ++threadAllocationCount;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* countedAlignedAllocation(std::size_t size, std::align_val_t alignment)
+    {
+        ++threadAllocationCount;
+
+        const auto align = juce::jmax((std::size_t)alignment, sizeof(void*));
+        void* p = nullptr;
+
+       #if JUCE_WINDOWS
+        p = _aligned_malloc(size == 0 ? 1 : size, align);
+       #else
+        if (posix_memalign(&p, align, size == 0 ? 1 : size) != 0)
+            p = nullptr;
+       #endif
+
+        return p;
+    }
+
+    void freeAligned(void* p) noexcept
+    {
+       #if JUCE_WINDOWS
+        _aligned_free(p);
+       #else
+        std::free(p);
+       #endif
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    if (auto* p = countedAllocation(size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocation(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (auto* p = countedAlignedAllocation(size, alignment))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAlignedAllocation(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAlignedAllocation(size, alignment);
+}
+
+void operator delete(void* p) noexcept                                          { std::free(p); }
+void operator delete[](void* p) noexcept                                        { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept                             { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept                           { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept                   { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept                 { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept                        { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept                      { freeAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept           { freeAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept         { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+
+//==============================================================================
+// juce::HeapBlock, and with it juce::Array and AudioBuffer, calls std::malloc
+// directly. glibc lets a program interpose malloc and forward to its own
+// implementation, so on Linux those are counted too; elsewhere only the C++
+// allocator is seen.
+#if defined(__GLIBC__)
+extern "C"
+{
+    void* __libc_malloc(std::size_t);
+    void* __libc_calloc(std::size_t, std::size_t);
+    void* __libc_realloc(void*, std::size_t);
+
+    void* malloc(std::size_t size)
+    {
+        ++threadAllocationCount;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size)
+    {
+        ++threadAllocationCount;
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* p, std::size_t size)
+    {
+        ++threadAllocationCount;
+        return __libc_realloc(p, size);
+    }
+}
+#endif
+#endif
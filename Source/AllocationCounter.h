@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.h
+
+    Debug hook that counts heap allocations made on the calling thread, so
+    the realtime path can prove it never touches the allocator.
+
+    Build with MARS_COUNT_ALLOCATIONS=1 to replace every form of the global
+    operator new, and on glibc malloc, calloc and realloc as well, which is
+    what juce::HeapBlock (and so juce::Array and AudioBuffer) goes through.
+    On other platforms those are not seen. Without the flag everything here
+    compiles down to nothing. MarsRender --check fails any case whose
+    processBlock allocated.
+
+    Only MarsRender's Debug build sets the flag. In a plugin the replacements
+    would hook the allocator of the whole host process, so plugin builds
+    refuse it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef MARS_COUNT_ALLOCATIONS
+ #define MARS_COUNT_ALLOCATIONS 0
+#endif
+
+#if MARS_COUNT_ALLOCATIONS && (JucePlugin_Build_VST || JucePlugin_Build_VST3 || JucePlugin_Build_AU \
+                               || JucePlugin_Build_AUv3 || JucePlugin_Build_AAX || JucePlugin_Build_LV2)
+ #error "MARS_COUNT_ALLOCATIONS replaces the global allocator, it is for MarsRender, not for plugin builds"
+#endif
+
+struct AllocationCounter
+{
+    // false when built without MARS_COUNT_ALLOCATIONS, nothing is counted then
+    static constexpr bool isEnabled = MARS_COUNT_ALLOCATIONS != 0;
+
+    // number of allocations made by the calling thread since it started
+    static juce::uint64 getThreadAllocationCount() noexcept;
+
+    // number of ScopedAllocationCheck scopes that saw an allocation, across all threads
+    static juce::uint64 getNumViolations() noexcept;
+    static void resetViolations() noexcept;
+
+    static void reportViolation() noexcept;
+};
+
+//==============================================================================
+/** Put one of these at the top of a realtime function. If anything inside the
+    scope allocates, the violation counter is bumped and a debug build asserts.
+*/
+class ScopedAllocationCheck
+{
+public:
+   #if MARS_COUNT_ALLOCATIONS
+    ScopedAllocationCheck() noexcept : startCount(AllocationCounter::getThreadAllocationCount()) {}
+
+    ~ScopedAllocationCheck()
+    {
+        if (AllocationCounter::getThreadAllocationCount() != startCount)
+        {
+            AllocationCounter::reportViolation();
+            jassertfalse; // something on the audio thread hit the heap
+        }
+    }
+
+private:
+    juce::uint64 startCount;
+   #else
+    ScopedAllocationCheck() noexcept {}
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedAllocationCheck)
+};
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    AnalysisFifo.cpp
+
+  ==============================================================================
+*/
+
+#include "AnalysisFifo.h"
+
+namespace
+{
+    constexpr juce::uint32 indexMask = (juce::uint32)AnalysisFifo::capacity - 1;
+}
+
+AnalysisFifo::AnalysisFifo()
+    : ring(numChannels, capacity)
+{
+    ring.clear();
+}
+
+void AnalysisFifo::push(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    if (buffer.getNumChannels() == 0)
+        return;
+
+    const auto write = writeIndex.load(std::memory_order_relaxed);
+    const auto read = readIndex.load(std::memory_order_acquire);
+    const auto numSamples = juce::jmin(buffer.getNumSamples(), capacity - (int)(write - read));
+
+    if (numSamples <= 0)
+        return;
+
+    const auto start = (int)(write & indexMask);
+    const auto first = juce::jmin(numSamples, capacity - start);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto* source = buffer.getReadPointer(juce::jmin(ch, buffer.getNumChannels() - 1));
+        auto* destination = ring.getWritePointer(ch);
+
+        juce::FloatVectorOperations::copy(destination + start, source, first);
+        juce::FloatVectorOperations::copy(destination, source + first, numSamples - first);
+    }
+
+    writeIndex.store(write + (juce::uint32)numSamples, std::memory_order_release);
+}
+
+int AnalysisFifo::pop(juce::AudioBuffer<float>& destination) noexcept
+{
+    jassert(destination.getNumChannels() >= numChannels);
+
+    const auto read = readIndex.load(std::memory_order_relaxed);
+    const auto write = writeIndex.load(std::memory_order_acquire);
+    const auto numSamples = juce::jmin((int)(write - read), destination.getNumSamples());
+
+    if (numSamples <= 0)
+        return 0;
+
+    const auto start = (int)(read & indexMask);
+    const auto first = juce::jmin(numSamples, capacity - start);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto* source = ring.getReadPointer(ch);
+        auto* target = destination.getWritePointer(ch);
+
+        juce::FloatVectorOperations::copy(target, source + start, first);
+        juce::FloatVectorOperations::copy(target + first, source, numSamples - first);
+    }
+
+    readIndex.store(read + (juce::uint32)numSamples, std::memory_order_release);
+    return numSamples;
+}
+
+void AnalysisFifo::discard() noexcept
+{
+    readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+}
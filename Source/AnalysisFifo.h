@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    AnalysisFifo.h
+
+    Single producer, single consumer ring that carries the output from
+    processBlock to the analysis thread. Pushing is a copy of the first two
+    channels and one atomic store, it never waits and never allocates; what
+    doesn't fit while the reader is behind is dropped.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class AnalysisFifo
+{
+public:
+    static constexpr int capacity = 1 << 15;
+    static constexpr int numChannels = 2;
+
+    AnalysisFifo();
+
+    // audio thread, mono input goes to both channels
+    void push(const juce::AudioBuffer<float>& buffer) noexcept;
+
+    // analysis thread: copies up to destination's length and returns how many samples that was
+    int pop(juce::AudioBuffer<float>& destination) noexcept;
+
+    // analysis side, drops whatever is waiting
+    void discard() noexcept;
+
+private:
+    juce::AudioBuffer<float> ring;
+
+    // free running, only the low bits pick the slot
+    std::atomic<juce::uint32> writeIndex{ 0 }, readIndex{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisFifo)
+};
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    AnalysisPlots.h
+
+    Plot sources for the foleys GUI that draw what a SignalAnalyser measured:
+    the output spectrum, the RMS and peak level history, and the level
+    envelope the RT60 estimate is taken from. All of them span floorDb to
+    0 dB from bottom to top.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SignalAnalyser.h"
+#include "MeasurementPlot.h"
+
+// only repaints when the analyser finished a new frame
+class AnalyserPlot  : public MeasurementPlot
+{
+protected:
+    explicit AnalyserPlot(const SignalAnalyser& analyserToShow) : analyser(analyserToShow) {}
+
+    template <size_t size>
+    static void addLevelPath(juce::Path& path, const std::array<float, size>& levelsDb, juce::Rectangle<float> bounds)
+    {
+        PlotPaths::addPath(path, levelsDb, bounds, SignalAnalyser::floorDb, 0.0f);
+    }
+
+    virtual void copyFrame() = 0;
+
+    const SignalAnalyser& analyser;
+
+private:
+    bool copyLatest() override
+    {
+        const auto frame = analyser.getFrameCount();
+
+        if (frame == lastFrame)
+            return false;
+
+        lastFrame = frame;
+        copyFrame();
+        return true;
+    }
+
+    juce::uint32 lastFrame = 0;
+};
+
+//==============================================================================
+// one curve with the area under it filled, copied out of the analyser by copyCurve
+template <size_t size, void (SignalAnalyser::*copyCurve)(std::array<float, size>&) const>
+class LevelCurvePlot  : public AnalyserPlot
+{
+public:
+    explicit LevelCurvePlot(const SignalAnalyser& analyserToShow) : AnalyserPlot(analyserToShow) {}
+
+    void createPlotPaths(juce::Path& path, juce::Path& filledPath, juce::Rectangle<float> bounds, foleys::MagicPlotComponent&) override
+    {
+        addLevelPath(path, levels, bounds);
+
+        filledPath = path;
+        PlotPaths::closeToBottom(filledPath, bounds);
+    }
+
+private:
+    void copyFrame() override { (analyser.*copyCurve)(levels); }
+
+    std::array<float, size> levels{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelCurvePlot)
+};
+
+using SpectrumPlot = LevelCurvePlot<SignalAnalyser::numSpectrumPoints, &SignalAnalyser::copySpectrum>;
+using DecayPlot = LevelCurvePlot<SignalAnalyser::decayHistorySize, &SignalAnalyser::copyDecay>;
+
+// peak as the line, RMS as the filled area
+class LevelPlot  : public AnalyserPlot
+{
+public:
+    explicit LevelPlot(const SignalAnalyser& analyserToShow) : AnalyserPlot(analyserToShow) {}
+
+    void createPlotPaths(juce::Path& path, juce::Path& filledPath, juce::Rectangle<float> bounds, foleys::MagicPlotComponent&) override
+    {
+        addLevelPath(path, peak, bounds);
+
+        addLevelPath(filledPath, rms, bounds);
+        PlotPaths::closeToBottom(filledPath, bounds);
+    }
+
+private:
+    void copyFrame() override { analyser.copyLevels(rms, peak); }
+
+    std::array<float, SignalAnalyser::levelHistorySize> rms{}, peak{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelPlot)
+};
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    BounceEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "BounceEngine.h"
+
+BounceEngine::BounceEngine()
+    : juce::Thread("Mars bounce worker")
+{
+}
+
+BounceEngine::~BounceEngine()
+{
+    stop();
+}
+
+void BounceEngine::start()
+{
+    if (isThreadRunning())
+        return;
+
+    startThread();
+    active.store(true, std::memory_order_release);
+}
+
+void BounceEngine::stop()
+{
+    active.store(false, std::memory_order_release);
+
+    // a job posted after the worker left is taken back and run by its caller
+    signalThreadShouldExit();
+    jobReady.signal();
+    stopThread(1000);
+}
+
+void BounceEngine::run()
+{
+    // the same as the audio thread, whose work this is
+    juce::ScopedNoDenormals noDenormals;
+
+    while (! threadShouldExit())
+    {
+        jobReady.wait(-1);
+
+        // a job that was handed over is always finished, the caller is waiting for it
+        if (auto* pending = job.exchange(nullptr, std::memory_order_acquire))
+        {
+            pending(jobContext);
+            jobDone.signal();
+        }
+    }
+}
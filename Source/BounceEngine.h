@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    BounceEngine.h
+
+    Second pair of hands for offline renders. While the host bounces, one
+    persistent worker thread takes the right channel's half of the stages
+    that keep a separate voice per side, and the audio thread does the left
+    half at the same time. In realtime playback the worker isn't running
+    and both halves are done in line.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <type_traits>
+
+class BounceEngine  : private juce::Thread
+{
+public:
+    // below this a handoff costs more than the work it moves
+    static constexpr int minimumParallelSamples = 256;
+
+    BounceEngine();
+    ~BounceEngine() override;
+
+    // message thread, called when the host enters or leaves offline rendering
+    void start();
+    void stop();
+
+    bool isActive() const noexcept { return active.load(std::memory_order_acquire); }
+
+    /** Runs first on the calling thread and second on the worker, and returns
+        once both are done. The two mustn't share any state. Without a running
+        worker both just run here, one after the other.
+    */
+    template <typename First, typename Second>
+    void runInParallel(First&& first, Second&& second) noexcept
+    {
+        if (! isActive())
+        {
+            first();
+            second();
+            return;
+        }
+
+        // no std::function: the job is a plain pointer to a callable on our stack
+        using SecondType = std::remove_reference_t<Second>;
+        jobContext = &second;
+        job.store([](void* context) { (*static_cast<SecondType*>(context))(); }, std::memory_order_release);
+        jobReady.signal();
+
+        first();
+
+        // Still there means the worker never picked it up, e.g. stop() ran after the
+        // isActive() check above, so it's done here. Otherwise the worker has it and
+        // always finishes it.
+        if (auto* unclaimed = job.exchange(nullptr, std::memory_order_acq_rel))
+        {
+            unclaimed(jobContext);
+            return;
+        }
+
+        jobDone.wait();
+    }
+
+private:
+    using Job = void (*)(void*);
+
+    void run() override;
+
+    std::atomic<bool> active{ false };
+    std::atomic<Job> job{ nullptr };
+    void* jobContext = nullptr;
+    juce::WaitableEvent jobReady, jobDone;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BounceEngine)
+};
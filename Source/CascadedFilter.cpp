@@ -0,0 +1,281 @@
+/*
+  ==============================================================================
+
+    CascadedFilter.cpp
+
+  ==============================================================================
+*/
+
+#include "CascadedFilter.h"
+
+namespace
+{
+    // k = 1/Q = 2 cos((2i + 1) pi / 2N) for the sections of an order N Butterworth, lowest Q first
+    constexpr float butterworthDamping[3][CascadedFilter::maximumSections] = {
+        { 1.41421356f },
+        { 1.84775907f, 0.76536686f },
+        { 1.96157056f, 1.66293922f, 1.11114047f, 0.39018064f },
+    };
+
+    // the prewarped integrator gain tan(pi * cutoff / sampleRate) only depends on the
+    // normalised cutoff, so one table serves every instance and every rate
+    constexpr int gainTableSize = 2048;
+    constexpr float minimumNormalisedCutoff = 1.0e-5f;
+    constexpr float maximumNormalisedCutoff = 0.49f;
+
+    struct GainTable
+    {
+        GainTable()
+        {
+            for (int i = 0; i <= gainTableSize; ++i)
+                gains[(size_t)i] = (float)std::tan(juce::MathConstants<double>::pi * maximumNormalisedCutoff * i / gainTableSize);
+        }
+
+        float lookup(float normalisedCutoff) const noexcept
+        {
+            const auto clipped = juce::jlimit(minimumNormalisedCutoff, maximumNormalisedCutoff, normalisedCutoff);
+            const auto position = clipped * ((float)gainTableSize / maximumNormalisedCutoff);
+            const auto index = juce::jmin((int)position, gainTableSize - 1);
+            const auto fraction = position - (float)index;
+
+            return gains[(size_t)index] + fraction * (gains[(size_t)index + 1] - gains[(size_t)index]);
+        }
+
+        std::array<float, gainTableSize + 1> gains;
+    };
+
+    // built on first use, which prepare() makes sure isn't the audio thread
+    const GainTable& getGainTable()
+    {
+        static const GainTable table;
+        return table;
+    }
+}
+
+//==============================================================================
+void CascadedFilter::setType(Type newType) noexcept
+{
+    if (newType != type)
+    {
+        type = newType;
+        reset();
+    }
+}
+
+void CascadedFilter::setSlope(Slope newSlope) noexcept
+{
+    if (newSlope == slope)
+        return;
+
+    for (int s = getNumSections(slope); s < getNumSections(newSlope); ++s)
+        for (auto* integrator : state[s])
+            std::fill(integrator, integrator + maximumChannels, 0.0f);
+
+    slope = newSlope;
+    updateCoefficients();
+}
+
+void CascadedFilter::setCutoff(float newFrequency) noexcept
+{
+    cutoff = newFrequency;
+    updateCoefficients();
+}
+
+void CascadedFilter::updateCoefficients() noexcept
+{
+    const auto g = getGainTable().lookup((float)(cutoff / sampleRate));
+    const auto* damping = butterworthDamping[(int)slope];
+
+    for (int s = 0; s < getNumSections(slope); ++s)
+    {
+        auto& section = sections[(size_t)s];
+        section.k = damping[s];
+        section.a1 = 1.0f / (1.0f + g * (g + section.k));
+        section.a2 = g * section.a1;
+        section.a3 = g * section.a2;
+    }
+}
+
+//==============================================================================
+void CascadedFilter::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    jassert((int)spec.numChannels <= maximumChannels);
+
+    sampleRate = spec.sampleRate;
+    numChannels = juce::jmin((int)spec.numChannels, maximumChannels);
+
+   #if JUCE_USE_SIMD
+    constexpr auto width = (int)juce::dsp::SIMDRegister<float>::SIMDNumElements;
+    numLanes = (numChannels + width - 1) / width * width;
+   #else
+    numLanes = numChannels;
+   #endif
+
+    updateCoefficients();
+    reset();
+}
+
+void CascadedFilter::reset() noexcept
+{
+    for (auto& section : state)
+        for (auto* integrator : section)
+            std::fill(integrator, integrator + maximumChannels, 0.0f);
+
+    std::fill(std::begin(frames), std::end(frames), 0.0f);
+}
+
+void CascadedFilter::processSamples(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert((int)block.getNumChannels() <= numChannels);
+
+    const auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+    const auto numSamples = (int)block.getNumSamples();
+
+    // interleaved so sample i of every channel sits in one row of lanes
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        const auto chunk = juce::jmin(chunkSize, numSamples - start);
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            const auto* data = block.getChannelPointer((size_t)ch) + start;
+
+            for (int i = 0; i < chunk; ++i)
+                frames[i * numLanes + ch] = data[i];
+        }
+
+        processLanes(chunk);
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            auto* data = block.getChannelPointer((size_t)ch) + start;
+
+            for (int i = 0; i < chunk; ++i)
+                data[i] = frames[i * numLanes + ch];
+        }
+    }
+}
+
+void CascadedFilter::processLanes(int numSamples) noexcept
+{
+    const auto numSections = getNumSections(slope);
+    const auto highPass = type == Type::highPass;
+
+   #if JUCE_USE_SIMD
+    using Vec = juce::dsp::SIMDRegister<float>;
+    constexpr auto width = (int)Vec::SIMDNumElements;
+
+    for (int lane = 0; lane < numLanes; lane += width)
+    {
+        Vec s1[maximumSections], s2[maximumSections];
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            s1[s] = Vec::fromRawArray(state[s][0] + lane);
+            s2[s] = Vec::fromRawArray(state[s][1] + lane);
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto* frame = frames + i * numLanes + lane;
+            auto x = Vec::fromRawArray(frame);
+
+            for (int s = 0; s < numSections; ++s)
+            {
+                const auto& c = sections[(size_t)s];
+                const auto v3 = x - s2[s];
+                const auto v1 = s1[s] * c.a1 + v3 * c.a2;
+                const auto v2 = s2[s] + s1[s] * c.a2 + v3 * c.a3;
+
+                s1[s] = v1 * 2.0f - s1[s];
+                s2[s] = v2 * 2.0f - s2[s];
+                x = highPass ? x - v1 * c.k - v2 : v2;
+            }
+
+            x.copyToRawArray(frame);
+        }
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            s1[s].copyToRawArray(state[s][0] + lane);
+            s2[s].copyToRawArray(state[s][1] + lane);
+        }
+    }
+   #else
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = frames[i * numLanes + lane];
+
+            for (int s = 0; s < numSections; ++s)
+            {
+                const auto& c = sections[(size_t)s];
+                auto& s1 = state[s][0][lane];
+                auto& s2 = state[s][1][lane];
+
+                const auto v3 = x - s2;
+                const auto v1 = c.a1 * s1 + c.a2 * v3;
+                const auto v2 = s2 + c.a2 * s1 + c.a3 * v3;
+
+                s1 = 2.0f * v1 - s1;
+                s2 = 2.0f * v2 - s2;
+                x = highPass ? x - c.k * v1 - v2 : v2;
+            }
+
+            frames[i * numLanes + lane] = x;
+        }
+    }
+   #endif
+}
+
+//==============================================================================
+float CascadedFilter::runBiquadComparison(Type typeToTest, double sampleRate, int numSamples)
+{
+    constexpr int blockSize = 512;
+    float maxError = 0.0f;
+
+    // the ends of the Low Cut and High Cut ranges and a couple in between
+    for (auto frequency : { 20.0f, 200.0f, 2000.0f, 18000.0f })
+    {
+        CascadedFilter candidate;
+        candidate.setType(typeToTest);
+        candidate.setSlope(Slope::db12);
+        candidate.prepare({ sampleRate, (juce::uint32)blockSize, 1 });
+        candidate.setCutoff(frequency);
+
+        juce::dsp::IIR::Filter<double> reference(typeToTest == Type::lowPass
+                                                     ? juce::dsp::IIR::Coefficients<double>::makeLowPass(sampleRate, frequency)
+                                                     : juce::dsp::IIR::Coefficients<double>::makeHighPass(sampleRate, frequency));
+
+        juce::AudioBuffer<float> buffer(1, blockSize);
+        juce::Random random(0x6d617273);
+
+        for (int done = 0; done < numSamples; done += blockSize)
+        {
+            for (int i = 0; i < blockSize; ++i)
+                buffer.setSample(0, i, random.nextFloat() * 2.0f - 1.0f);
+
+            double expected[blockSize];
+
+            for (int i = 0; i < blockSize; ++i)
+                expected[i] = reference.processSample((double)buffer.getSample(0, i));
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            candidate.process(juce::dsp::ProcessContextReplacing<float>(block));
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const auto error = (float)std::abs(expected[i] - (double)buffer.getSample(0, i));
+
+                // jmax would keep the old value over a NaN
+                if (! std::isfinite(error))
+                    return std::numeric_limits<float>::infinity();
+
+                maxError = juce::jmax(maxError, error);
+            }
+        }
+    }
+
+    return maxError;
+}
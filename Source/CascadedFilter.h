@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    CascadedFilter.h
+
+    Master Low Cut / High Cut: a Butterworth low or high pass of 12, 24 or
+    48 dB/oct, built from one, two or four TPT state-variable sections in
+    series. At 12 dB it has the response of the RBJ biquad it replaces;
+    runBiquadComparison() measures how closely it follows one.
+
+    The channels run side by side in SIMD lanes, each section's state for
+    all of them in one register, and the prewarped cutoff comes from a table
+    shared by every instance, so a cutoff change is a lookup and a handful
+    of multiplies.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class CascadedFilter
+{
+public:
+    enum class Type
+    {
+        lowPass,
+        highPass
+    };
+
+    // the choice index of the filterSlope parameter
+    enum class Slope
+    {
+        db12,
+        db24,
+        db48
+    };
+
+    static constexpr int maximumSections = 4;
+    static constexpr int maximumChannels = 16;
+
+    CascadedFilter() = default;
+
+    void setType(Type newType) noexcept;
+    Type getType() const noexcept { return type; }
+
+    // sections that become active start from silence, the others keep their state
+    void setSlope(Slope newSlope) noexcept;
+    Slope getSlope() const noexcept { return slope; }
+
+    // no allocation and no trigonometry, safe to call every few samples while a cutoff ramps
+    void setCutoff(float newFrequency) noexcept;
+    float getCutoff() const noexcept { return cutoff; }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        auto& outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(context.getInputBlock());
+
+        if (context.isBypassed || outputBlock.getNumChannels() == 0)
+            return;
+
+        processSamples(outputBlock);
+    }
+
+    static int getNumSections(Slope slope) noexcept { return 1 << (int)slope; }
+
+    /** Renders the same noise through a 12 dB filter of this type and through
+        the RBJ biquad, run in double, at a spread of cutoffs, and returns the
+        largest absolute sample difference, infinity if either produced
+        something that isn't finite. MarsRender --check runs it for both types.
+    */
+    static float runBiquadComparison(Type typeToTest, double sampleRate = 48000.0, int numSamples = 48000);
+
+private:
+    // samples interleaved per pass, bounded by the scratch below
+    static constexpr int chunkSize = 32;
+
+    void updateCoefficients() noexcept;
+    void processSamples(const juce::dsp::AudioBlock<float>& block) noexcept;
+    void processLanes(int numSamples) noexcept;
+
+    Type type = Type::lowPass;
+    Slope slope = Slope::db12;
+    float cutoff = 1000.0f;
+    double sampleRate = 44100.0;
+
+    // channels rounded up to whole registers
+    int numChannels = 0, numLanes = 0;
+
+    // per section: the Butterworth damping k = 1/Q and the three TPT gains derived from it
+    struct Section
+    {
+        float k = 1.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    };
+
+    std::array<Section, maximumSections> sections;
+
+    // [section][integrator][lane]
+    alignas(32) float state[maximumSections][2][maximumChannels] = {};
+    alignas(32) float frames[chunkSize * maximumChannels] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CascadedFilter)
+};
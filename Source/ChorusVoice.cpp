@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    ChorusVoice.cpp
+
+  ==============================================================================
+*/
+
+#include "ChorusVoice.h"
+
+void ChorusVoice::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    jassert((int)spec.numChannels <= maximumChannels);
+
+    sampleRate = spec.sampleRate;
+    numChannels = juce::jmin((int)spec.numChannels, maximumChannels);
+
+    // the longest delay plus a sample for the interpolation
+    const auto maximumDelaySamples = (centreDelayMs + maximumModulationMs) * 0.001 * sampleRate;
+    delayLines.setSize(numChannels, (int)std::ceil(maximumDelaySamples) + 2);
+    controls.setSize(3, (int)spec.maximumBlockSize);
+
+    depth.reset(sampleRate, smoothingSeconds);
+    feedback.reset(sampleRate, smoothingSeconds);
+    mix.reset(sampleRate, smoothingSeconds);
+
+    reset();
+}
+
+void ChorusVoice::reset() noexcept
+{
+    delayLines.clear();
+    writePosition = 0;
+    lastOutputs.fill(0.0f);
+
+    depth.setCurrentAndTargetValue(depth.getTargetValue());
+    feedback.setCurrentAndTargetValue(feedback.getTargetValue());
+    mix.setCurrentAndTargetValue(mix.getTargetValue());
+}
+
+void ChorusVoice::process(const juce::dsp::AudioBlock<float>& block, const float* lfo) noexcept
+{
+    const auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+    const auto numSamples = juce::jmin((int)block.getNumSamples(), controls.getNumSamples());
+    const auto lineLength = delayLines.getNumSamples();
+
+    jassert((int)block.getNumSamples() <= controls.getNumSamples());
+
+    auto* delays = controls.getWritePointer(0);
+    auto* feedbacks = controls.getWritePointer(1);
+    auto* mixes = controls.getWritePointer(2);
+
+    const auto samplesPerMs = (float)(sampleRate * 0.001);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto delayMs = juce::jmax(1.0f, centreDelayMs + maximumModulationMs * depth.getNextValue() * lfo[i]);
+        delays[i] = delayMs * samplesPerMs;
+        feedbacks[i] = feedback.getNextValue();
+        mixes[i] = mix.getNextValue();
+    }
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        auto* data = block.getChannelPointer((size_t)ch);
+        auto* line = delayLines.getWritePointer(ch);
+        auto lastOutput = lastOutputs[(size_t)ch];
+        auto write = writePosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto dry = data[i];
+            line[write] = dry - lastOutput;
+
+            auto readPosition = (float)write - delays[i];
+
+            if (readPosition < 0.0f)
+                readPosition += (float)lineLength;
+
+            const auto index = juce::jmin((int)readPosition, lineLength - 1);
+            const auto fraction = readPosition - (float)index;
+            const auto next = index + 1 == lineLength ? 0 : index + 1;
+            const auto wet = line[index] + fraction * (line[next] - line[index]);
+
+            // the feedback goes into the line on the next sample, flushed like FreeverbCore's
+            // all-passes so a dying tail never fills the line with denormals
+            lastOutput = wet * feedbacks[i];
+            juce::dsp::util::snapToZero(lastOutput);
+
+            data[i] = dry + mixes[i] * (wet - dry);
+
+            if (++write == lineLength)
+                write = 0;
+        }
+
+        lastOutputs[(size_t)ch] = lastOutput;
+    }
+
+    writePosition = (writePosition + numSamples) % lineLength;
+}
@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    ChorusVoice.h
+
+    The modulated delay juce::dsp::Chorus runs, with its defaults of a 7 ms
+    centre delay swung by up to 10 ms, negative feedback and a linear dry/wet
+    mix, but driven by an LFO handed in with each block instead of a sine
+    oscillator of its own. All the channels of a voice follow the same LFO.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class ChorusVoice
+{
+public:
+    static constexpr int maximumChannels = 8;
+
+    ChorusVoice() = default;
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    void setDepth(float newDepth) noexcept { depth.setTargetValue(newDepth); }
+    void setFeedback(float newFeedback) noexcept { feedback.setTargetValue(newFeedback); }
+    void setMix(float newMix) noexcept { mix.setTargetValue(newMix); }
+
+    // in place, lfo holds a value in [-1, 1] for each sample of block
+    void process(const juce::dsp::AudioBlock<float>& block, const float* lfo) noexcept;
+
+private:
+    static constexpr float centreDelayMs = 7.0f;
+    static constexpr float maximumModulationMs = 10.0f;
+    static constexpr double smoothingSeconds = 0.05;
+
+    double sampleRate = 44100.0;
+    int numChannels = 0;
+
+    juce::AudioBuffer<float> delayLines;
+    int writePosition = 0;
+    std::array<float, maximumChannels> lastOutputs{};
+
+    // per sample of the block, shared by the channels: delay, feedback and mix
+    juce::AudioBuffer<float> controls;
+
+    juce::SmoothedValue<float> depth{ 0.25f }, feedback{ 0.0f }, mix{ 0.5f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChorusVoice)
+};
@@ -0,0 +1,473 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.cpp
+
+  ==============================================================================
+*/
+
+#include "ConvolutionReverb.h"
+
+namespace
+{
+    constexpr float outputScale = 0.45f; // a unit energy response, roughly level-matched to FreeverbCore
+    constexpr float wetScaleFactor = 3.0f;
+    constexpr float dryScaleFactor = 2.0f;
+
+    // anything after the last sample above this, relative to the peak, is dropped
+    constexpr float trimThreshold = 1.0e-6f;
+
+    // the resampler's windowed sinc: how many zero crossings it spans each side, how finely
+    // its table samples them, and how much of the lower Nyquist it keeps
+    constexpr int resamplerZeroCrossings = 32;
+    constexpr int resamplerTableResolution = 512;
+    constexpr double resamplerPassband = 0.9;
+
+    // band-limited to the lower of the two rates, so a downsampled response doesn't alias
+    juce::AudioBuffer<float> resample(const juce::AudioBuffer<float>& input, double inputRate, double outputRate)
+    {
+        if (juce::approximatelyEqual(inputRate, outputRate))
+            return input;
+
+        const auto ratio = inputRate / outputRate;
+        const auto numInputSamples = input.getNumSamples();
+        const auto numOutputSamples = (int)std::ceil(numInputSamples / ratio);
+
+        // cutoff relative to the input's Nyquist, the kernel stretches with it when downsampling
+        const auto cutoff = resamplerPassband * juce::jmin(1.0, 1.0 / ratio);
+        const auto halfWidth = resamplerZeroCrossings / cutoff;
+
+        // one side of the Blackman windowed sinc, indexed in zero crossings
+        std::vector<float> kernel((size_t)(resamplerZeroCrossings * resamplerTableResolution + 2));
+
+        for (size_t i = 0; i < kernel.size(); ++i)
+        {
+            const auto x = (double)i / resamplerTableResolution;
+
+            if (x >= resamplerZeroCrossings)
+                break;
+
+            const auto phase = juce::MathConstants<double>::pi * x;
+            const auto sinc = i == 0 ? 1.0 : std::sin(phase) / phase;
+            const auto window = 0.42 + 0.5 * std::cos(phase / resamplerZeroCrossings)
+                                     + 0.08 * std::cos(2.0 * phase / resamplerZeroCrossings);
+            kernel[i] = (float)(sinc * window);
+        }
+
+        const auto tableScale = cutoff * resamplerTableResolution;
+        juce::AudioBuffer<float> output(input.getNumChannels(), numOutputSamples);
+
+        for (int ch = 0; ch < input.getNumChannels(); ++ch)
+        {
+            const auto* in = input.getReadPointer(ch);
+            auto* out = output.getWritePointer(ch);
+
+            for (int n = 0; n < numOutputSamples; ++n)
+            {
+                const auto centre = n * ratio;
+                const auto first = juce::jmax(0, (int)std::ceil(centre - halfWidth));
+                const auto last = juce::jmin(numInputSamples - 1, (int)std::floor(centre + halfWidth));
+                double sum = 0.0;
+
+                for (int k = first; k <= last; ++k)
+                {
+                    const auto position = std::abs(k - centre) * tableScale;
+                    const auto index = juce::jmin((int)position, (int)kernel.size() - 2);
+                    const auto fraction = (float)(position - index);
+
+                    sum += in[k] * (kernel[(size_t)index] + fraction * (kernel[(size_t)index + 1] - kernel[(size_t)index]));
+                }
+
+                out[n] = (float)(sum * cutoff);
+            }
+        }
+
+        return output;
+    }
+
+    int getTrimmedLength(const juce::AudioBuffer<float>& buffer)
+    {
+        const auto peak = buffer.getMagnitude(0, buffer.getNumSamples());
+
+        if (peak <= 0.0f)
+            return 0;
+
+        int length = 0;
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            const auto* data = buffer.getReadPointer(ch);
+
+            for (int i = buffer.getNumSamples(); --i >= length;)
+            {
+                if (std::abs(data[i]) > peak * trimThreshold)
+                {
+                    length = i + 1;
+                    break;
+                }
+            }
+        }
+
+        return length;
+    }
+
+    void normaliseEnergy(juce::AudioBuffer<float>& buffer)
+    {
+        double energy = 0.0;
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            const auto* data = buffer.getReadPointer(ch);
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                energy += (double)data[i] * data[i];
+        }
+
+        energy /= buffer.getNumChannels();
+
+        if (energy > 0.0)
+            buffer.applyGain((float)(1.0 / std::sqrt(energy)));
+    }
+
+    // resampled to the processing rate, trimmed and normalised; nullptr if it's silent
+    ImpulseResponseSpectra::Ptr buildSpectra(const juce::AudioBuffer<float>& input, double inputRate, double rate)
+    {
+        auto impulseResponse = resample(input, inputRate, rate);
+        const auto length = getTrimmedLength(impulseResponse);
+
+        if (length == 0)
+            return nullptr;
+
+        impulseResponse.setSize(impulseResponse.getNumChannels(), length, true);
+        normaliseEnergy(impulseResponse);
+
+        return ImpulseResponseSpectra::create(impulseResponse, rate);
+    }
+
+    void readImpulseResponse(juce::AudioFormatManager& formatManager, const juce::File& file,
+                             juce::AudioBuffer<float>& buffer, double& bufferSampleRate)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return;
+
+        const auto length = (int)juce::jmin(reader->lengthInSamples,
+                                            (juce::int64)(ConvolutionReverb::maximumImpulseResponseSeconds * reader->sampleRate));
+
+        buffer.setSize(juce::jmin(2, (int)reader->numChannels), length);
+        reader->read(&buffer, 0, length, 0, true, buffer.getNumChannels() > 1);
+        bufferSampleRate = reader->sampleRate;
+    }
+}
+
+//==============================================================================
+ConvolutionReverb::ConvolutionReverb()
+    : juce::Thread("Convolution Loader")
+{
+    setParameters(Parameters());
+    loaderIdle.signal();
+}
+
+ConvolutionReverb::~ConvolutionReverb()
+{
+    stopThread(4000);
+
+    delete pendingEngine.exchange(nullptr);
+    delete retiredEngine.exchange(nullptr);
+}
+
+void ConvolutionReverb::setParameters(const Parameters& newParams)
+{
+    const float wetLevel = newParams.wetLevel * wetScaleFactor * outputScale;
+    dryGain.setTargetValue(newParams.dryLevel * dryScaleFactor);
+    wetGain1.setTargetValue(0.5f * wetLevel * (1.0f + newParams.width));
+    wetGain2.setTargetValue(0.5f * wetLevel * (1.0f - newParams.width));
+
+    parameters = newParams;
+}
+
+//==============================================================================
+bool ConvolutionReverb::loadImpulseResponse(const juce::File& file)
+{
+    if (! file.existsAsFile())
+        return false;
+
+    {
+        const juce::ScopedLock sl(requestLock);
+        requestedFile = file;
+        fileRequested = true;
+        bufferRequested = false;
+        loaderIdle.reset();
+    }
+
+    if (! isThreadRunning())
+        startThread();
+
+    notify();
+    return true;
+}
+
+void ConvolutionReverb::loadImpulseResponse(juce::AudioBuffer<float>&& impulseResponse, double impulseResponseSampleRate)
+{
+    {
+        const juce::ScopedLock sl(requestLock);
+        requestedBuffer = std::move(impulseResponse);
+        requestedSampleRate = impulseResponseSampleRate;
+        bufferRequested = true;
+        fileRequested = false;
+        loaderIdle.reset();
+    }
+
+    if (! isThreadRunning())
+        startThread();
+
+    notify();
+}
+
+juce::File ConvolutionReverb::getImpulseResponseFile() const
+{
+    const juce::ScopedLock sl(requestLock);
+    return sourceFile;
+}
+
+bool ConvolutionReverb::waitForLoader(int timeoutMs) const
+{
+    return loaderIdle.wait(timeoutMs);
+}
+
+//==============================================================================
+void ConvolutionReverb::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    const auto rateChanged = ! juce::approximatelyEqual(sampleRate.exchange(spec.sampleRate), spec.sampleRate);
+
+    wet.setSize(2, (int)spec.maximumBlockSize);
+
+    const double smoothTime = 0.01;
+    dryGain.reset(spec.sampleRate, smoothTime);
+    wetGain1.reset(spec.sampleRate, smoothTime);
+    wetGain2.reset(spec.sampleRate, smoothTime);
+
+    if (rateChanged)
+    {
+        const juce::ScopedLock sl(requestLock);
+
+        if (hasSource)
+        {
+            rebuildRequested = true;
+            loaderIdle.reset();
+            notify();
+        }
+    }
+}
+
+void ConvolutionReverb::reset() noexcept
+{
+    if (engine != nullptr)
+        engine->reset();
+}
+
+void ConvolutionReverb::setNonRealtime(bool isNonRealtime) noexcept
+{
+    nonRealtime = isNonRealtime;
+
+    if (engine != nullptr)
+        engine->setNonRealtime(nonRealtime);
+}
+
+size_t ConvolutionReverb::getMemoryFootprintBytes() const noexcept
+{
+    // engine itself belongs to the audio thread, and the loader frees the ones it swaps out
+    return (size_t)wet.getNumChannels() * (size_t)wet.getNumSamples() * sizeof(float) + engineFootprintBytes.load();
+}
+
+//==============================================================================
+void ConvolutionReverb::run()
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    while (! threadShouldExit())
+    {
+        // the audio thread can't free the engine it swapped out, and won't swap again until it's gone
+        delete retiredEngine.exchange(nullptr);
+
+        juce::AudioBuffer<float> input;
+        double inputRate = 0.0;
+        juce::File file;
+        juce::MD5 hash;
+        bool hasRequest = true, newSource = true;
+
+        {
+            const juce::ScopedLock sl(requestLock);
+
+            if (fileRequested)
+            {
+                file = requestedFile;
+            }
+            else if (bufferRequested)
+            {
+                input = std::move(requestedBuffer);
+                inputRate = requestedSampleRate;
+            }
+            else if (rebuildRequested && hasSource)
+            {
+                file = sourceFile;
+                input.makeCopyOf(source);
+                inputRate = sourceSampleRate;
+                hash = sourceHash;
+                newSource = false;
+            }
+            else
+            {
+                hasRequest = false;
+            }
+
+            fileRequested = bufferRequested = rebuildRequested = false;
+        }
+
+        if (hasRequest)
+        {
+            if (newSource)
+                hash = file != juce::File() ? juce::MD5(file) : ImpulseResponseCache::hashAudio(input, inputRate);
+
+            const auto rate = sampleRate.load();
+            const auto key = ImpulseResponseCache::makeKey(hash, rate);
+            auto spectra = cache->find(key);
+
+            // decoding is only needed when no instance or earlier session has built this one
+            if (spectra == nullptr && input.getNumSamples() == 0 && file != juce::File())
+                readImpulseResponse(formatManager, file, input, inputRate);
+
+            if (spectra == nullptr && input.getNumSamples() > 0 && inputRate > 0.0)
+                if (auto built = buildSpectra(input, inputRate, rate))
+                    spectra = cache->add(key, built);
+
+            if (spectra != nullptr)
+            {
+                if (newSource)
+                {
+                    const juce::ScopedLock sl(requestLock);
+                    sourceFile = file;
+                    sourceHash = hash;
+
+                    // a file can be read again, no need for every instance to hold its audio
+                    if (file == juce::File())
+                        source = std::move(input);
+                    else
+                        source.setSize(0, 0);
+
+                    sourceSampleRate = inputRate;
+                    hasSource = true;
+                }
+
+                publishEngine(spectra);
+            }
+        }
+
+        if (threadShouldExit())
+            break;
+
+        const juce::ScopedLock sl(requestLock);
+
+        if (! (fileRequested || bufferRequested || rebuildRequested))
+        {
+            loaderIdle.signal();
+
+            // while an engine is on its way in, the one it replaces has to be collected too
+            const auto swapInProgress = pendingEngine.load() != nullptr || retiredEngine.load() != nullptr;
+
+            const juce::ScopedUnlock su(requestLock);
+            wait(swapInProgress ? retiredEnginePollMs : -1);
+        }
+    }
+}
+
+void ConvolutionReverb::publishEngine(ImpulseResponseSpectra::Ptr spectra)
+{
+    const auto seconds = spectra->length / spectra->sampleRate;
+
+    auto next = std::make_unique<PartitionedConvolver>();
+    next->prepare(std::move(spectra), 2);
+
+    // an engine the audio thread never picked up is simply replaced
+    delete retiredEngine.exchange(nullptr);
+    delete pendingEngine.exchange(next.release());
+    impulseResponseSeconds = seconds;
+}
+
+//==============================================================================
+void ConvolutionReverb::swapInPendingEngine() noexcept
+{
+    // the last swapped out engine has to be freed by the loader before the next can come in
+    if (retiredEngine.load() != nullptr || pendingEngine.load() == nullptr)
+        return;
+
+    retiredEngine.store(engine.release());
+    engine.reset(pendingEngine.exchange(nullptr));
+    engine->setNonRealtime(nonRealtime);
+    engineFootprintBytes = engine->getMemoryFootprintBytes() + engine->getSpectra()->getMemoryFootprintBytes();
+}
+
+void ConvolutionReverb::processSamples(float* left, float* right, int numSamples) noexcept
+{
+    swapInPendingEngine();
+
+    // nothing loaded yet, or still built for the rate before the last prepare: the dry path alone
+    if (engine == nullptr || ! juce::approximatelyEqual(engine->getSpectra()->sampleRate, sampleRate.load()))
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto dry = dryGain.getNextValue();
+            left[i] *= dry;
+
+            if (right != nullptr)
+                right[i] *= dry;
+        }
+
+        wetGain1.skip(numSamples);
+        wetGain2.skip(numSamples);
+        return;
+    }
+
+    const auto numChannels = right != nullptr ? 2 : 1;
+    auto* wetLeft = wet.getWritePointer(0);
+    auto* wetRight = wet.getWritePointer(1);
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        const auto chunk = juce::jmin(numSamples - offset, wet.getNumSamples());
+        auto* l = left + offset;
+        auto* r = right != nullptr ? right + offset : nullptr;
+
+        const float* input[] = { l, r };
+        float* output[] = { wetLeft, wetRight };
+        engine->process(input, output, numChannels, chunk);
+
+        if (r != nullptr)
+        {
+            for (int i = 0; i < chunk; ++i)
+            {
+                const auto dry = dryGain.getNextValue();
+                const auto wet1 = wetGain1.getNextValue();
+                const auto wet2 = wetGain2.getNextValue();
+
+                l[i] = l[i] * dry + wetLeft[i] * wet1 + wetRight[i] * wet2;
+                r[i] = r[i] * dry + wetRight[i] * wet1 + wetLeft[i] * wet2;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < chunk; ++i)
+            {
+                const auto dry = dryGain.getNextValue();
+                const auto wet1 = wetGain1.getNextValue();
+                wetGain2.getNextValue();
+
+                l[i] = l[i] * dry + wetLeft[i] * wet1;
+            }
+        }
+
+        offset += chunk;
+    }
+}
@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.h
+
+    "Convolution" algorithm: a loaded impulse response run through a
+    PartitionedConvolver, with no added latency.
+
+    Loading happens on this object's own loader thread: the file is decoded,
+    resampled to the processing rate, trimmed, normalised to unit energy and
+    partitioned, unless ImpulseResponseCache already has it, and the
+    finished engine is handed to the audio thread through an atomic pointer.
+    The engine it replaces comes back the same way and is freed by the
+    loader too, so swaps don't depend on a running message loop.
+
+    After a sample rate change the slot plays dry until the engine rebuilt
+    for the new rate is in; the old one would play the room at the wrong
+    pitch and length.
+
+    Takes the same juce::Reverb::Parameters as the other slot algorithms;
+    only the levels and width apply, the impulse response is the room.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PartitionedConvolver.h"
+#include "ImpulseResponseCache.h"
+
+class ConvolutionReverb  : private juce::Thread
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    // longer files are cut off here
+    static constexpr double maximumImpulseResponseSeconds = 20.0;
+
+    ConvolutionReverb();
+    ~ConvolutionReverb() override;
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return parameters; }
+    void setParameters(const Parameters& newParams);
+
+    //==============================================================================
+    /** Message thread. Returns false if the file doesn't exist; anything that
+        can't be decoded is dropped on the loader thread and the current
+        impulse response stays.
+    */
+    bool loadImpulseResponse(const juce::File& file);
+    void loadImpulseResponse(juce::AudioBuffer<float>&& impulseResponse, double impulseResponseSampleRate);
+
+    juce::File getImpulseResponseFile() const;
+    bool hasImpulseResponse() const noexcept { return impulseResponseSeconds.load() > 0.0; }
+
+    /** Not the audio thread. Waits until the loader has dealt with every request
+        made so far, whether they loaded or not; false if it gave up first.
+    */
+    bool waitForLoader(int timeoutMs) const;
+
+    //==============================================================================
+    // rebuilds the impulse response in the background if the rate changed
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    // audio thread, see PartitionedConvolver::setNonRealtime
+    void setNonRealtime(bool isNonRealtime) noexcept;
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numChannels = outputBlock.getNumChannels();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed || numChannels == 0)
+            return;
+
+        jassert(numChannels <= 2);
+
+        processSamples(outputBlock.getChannelPointer(0),
+                       numChannels > 1 ? outputBlock.getChannelPointer(1) : nullptr,
+                       (int)outputBlock.getNumSamples());
+    }
+
+    // any thread: the running engine's share is published by the audio thread when it swaps one in
+    size_t getMemoryFootprintBytes() const noexcept;
+
+    // length of the loaded impulse response, 0 without one
+    double getTailSeconds() const noexcept { return impulseResponseSeconds.load(); }
+
+private:
+    // how often the idle loader looks for a swapped out engine while a swap is under way
+    static constexpr int retiredEnginePollMs = 50;
+
+    void run() override;
+    void publishEngine(ImpulseResponseSpectra::Ptr spectra);
+    void swapInPendingEngine() noexcept;
+    void processSamples(float* left, float* right, int numSamples) noexcept;
+
+    Parameters parameters;
+    juce::SmoothedValue<float> dryGain, wetGain1, wetGain2;
+
+    std::atomic<double> sampleRate{ 44100.0 };
+    juce::AudioBuffer<float> wet;
+
+    // audio thread's engine, plus the two hand-over slots
+    std::unique_ptr<PartitionedConvolver> engine;
+    std::atomic<PartitionedConvolver*> pendingEngine{ nullptr }, retiredEngine{ nullptr };
+    std::atomic<double> impulseResponseSeconds{ 0.0 };
+    std::atomic<size_t> engineFootprintBytes{ 0 };
+    bool nonRealtime = false;
+
+    juce::SharedResourcePointer<ImpulseResponseCache> cache;
+
+    // what the loader works from, guarded by requestLock; source only holds
+    // audio that was handed over as a buffer, files are read again if needed
+    juce::CriticalSection requestLock;
+    juce::File requestedFile, sourceFile;
+    juce::AudioBuffer<float> requestedBuffer, source;
+    double requestedSampleRate = 0.0, sourceSampleRate = 0.0;
+    juce::MD5 sourceHash;
+    bool fileRequested = false, bufferRequested = false, rebuildRequested = false, hasSource = false;
+
+    // signalled while the loader has nothing left to do, reset along with every request
+    juce::WaitableEvent loaderIdle{ true };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConvolutionReverb)
+};
@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    DspLoadMeter.cpp
+
+  ==============================================================================
+*/
+
+#include "DspLoadMeter.h"
+
+void DspLoadMeter::prepare(double sampleRate) noexcept
+{
+    ticksPerSample = (double)juce::Time::getHighResolutionTicksPerSecond() / juce::jmax(1.0, sampleRate);
+    reset();
+}
+
+void DspLoadMeter::reset() noexcept
+{
+    for (auto& bin : histogram)
+        bin.store(0, std::memory_order_relaxed);
+
+    for (auto& load : history)
+        load.store(0.0f, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < (size_t)maxStages; ++i)
+    {
+        stageTicks[i].store(0, std::memory_order_relaxed);
+        stageCounts[i].store(0, std::memory_order_relaxed);
+    }
+
+    maxLoad.store(0.0f);
+    numXrunRisks.store(0);
+    numOverruns.store(0);
+}
+
+//==============================================================================
+void DspLoadMeter::endBlock(juce::int64 startTicks, int numSamples) noexcept
+{
+    if (numSamples <= 0 || ticksPerSample <= 0.0)
+        return;
+
+    const auto elapsed = juce::Time::getHighResolutionTicks() - startTicks;
+    const auto load = (float)((double)elapsed / (ticksPerSample * numSamples));
+
+    const auto bin = juce::jlimit(0, numBins - 1, (int)(load * binsPerUnit));
+    histogram[(size_t)bin].fetch_add(1, std::memory_order_relaxed);
+
+    for (auto previous = maxLoad.load(std::memory_order_relaxed); load > previous;)
+        if (maxLoad.compare_exchange_weak(previous, load, std::memory_order_relaxed))
+            break;
+
+    if (load > xrunRiskThreshold)
+        numXrunRisks.fetch_add(1, std::memory_order_relaxed);
+
+    if (load > 1.0f)
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+
+    // only the audio thread writes the position, so a plain load/store is enough
+    const auto position = historyPosition.load(std::memory_order_relaxed);
+    history[(size_t)position].store(load, std::memory_order_relaxed);
+    historyPosition.store((position + 1) % historySize, std::memory_order_release);
+}
+
+void DspLoadMeter::addStageTicks(int stage, juce::int64 ticks) noexcept
+{
+    if (! juce::isPositiveAndBelow(stage, maxStages))
+        return;
+
+    stageTicks[(size_t)stage].fetch_add(ticks, std::memory_order_relaxed);
+    stageCounts[(size_t)stage].fetch_add(1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+DspLoadMeter::Snapshot DspLoadMeter::getSnapshot() const noexcept
+{
+    Snapshot snapshot;
+
+    std::array<juce::uint32, numBins> counts;
+
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        counts[i] = histogram[i].load(std::memory_order_relaxed);
+        snapshot.numBlocks += counts[i];
+    }
+
+    auto percentile = [&](double fraction)
+    {
+        const auto target = (juce::uint64)std::ceil(fraction * (double)snapshot.numBlocks);
+        juce::uint64 sum = 0;
+
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            sum += counts[i];
+
+            // report the upper edge of the bin, so the estimate never flatters
+            if (sum >= target && sum > 0)
+                return (float)(i + 1) / binsPerUnit;
+        }
+
+        return 0.0f;
+    };
+
+    snapshot.p50 = percentile(0.5);
+    snapshot.p99 = percentile(0.99);
+    snapshot.max = maxLoad.load(std::memory_order_relaxed);
+    snapshot.numXrunRisks = numXrunRisks.load(std::memory_order_relaxed);
+    snapshot.numOverruns = numOverruns.load(std::memory_order_relaxed);
+
+    const auto ticksPerMicrosecond = (double)juce::Time::getHighResolutionTicksPerSecond() * 1.0e-6;
+
+    for (size_t i = 0; i < (size_t)maxStages; ++i)
+    {
+        const auto count = stageCounts[i].load(std::memory_order_relaxed);
+
+        if (count > 0)
+            snapshot.stageAverageMicroseconds[i] = (double)stageTicks[i].load(std::memory_order_relaxed) / (count * ticksPerMicrosecond);
+    }
+
+    return snapshot;
+}
+
+void DspLoadMeter::copyHistory(std::array<float, historySize>& destination) const noexcept
+{
+    const auto position = historyPosition.load(std::memory_order_acquire);
+
+    for (int i = 0; i < historySize; ++i)
+        destination[(size_t)i] = history[(size_t)((position + i) % historySize)].load(std::memory_order_relaxed);
+}
+
+bool DspLoadMeter::exportToFile(const juce::File& file, const juce::StringArray& stageNames) const
+{
+    const auto snapshot = getSnapshot();
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("blocks", (juce::int64)snapshot.numBlocks);
+    root->setProperty("p50", snapshot.p50);
+    root->setProperty("p99", snapshot.p99);
+    root->setProperty("max", snapshot.max);
+    root->setProperty("xrunRisks", (juce::int64)snapshot.numXrunRisks);
+    root->setProperty("overruns", (juce::int64)snapshot.numOverruns);
+
+    auto* stages = new juce::DynamicObject();
+
+    for (int i = 0; i < juce::jmin(stageNames.size(), maxStages); ++i)
+        stages->setProperty(stageNames[i], snapshot.stageAverageMicroseconds[(size_t)i]);
+
+    root->setProperty("stageAverageMicroseconds", juce::var(stages));
+
+    juce::Array<juce::var> bins;
+
+    for (const auto& bin : histogram)
+        bins.add((int)bin.load(std::memory_order_relaxed));
+
+    root->setProperty("histogramBinWidth", 1.0 / binsPerUnit);
+    root->setProperty("histogram", bins);
+
+    return file.replaceWithText(juce::JSON::toString(juce::var(root)));
+}
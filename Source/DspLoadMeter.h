@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    DspLoadMeter.h
+
+    Measures how much of each callback's deadline processBlock uses. The
+    audio thread only bumps atomic counters: one histogram bin per block,
+    a running maximum and a short history for plotting. The message thread
+    reads them back into percentiles for the GUI or a file.
+
+    Per-stage timing is optional and off by default, it costs two clock
+    reads per stage.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class DspLoadMeter
+{
+public:
+    static constexpr int maxStages = 8;
+    static constexpr int historySize = 256;
+
+    // a block using more than this share of its deadline counts as an xrun risk
+    static constexpr float xrunRiskThreshold = 0.8f;
+
+    struct Snapshot
+    {
+        juce::uint64 numBlocks = 0;
+        float p50 = 0.0f, p99 = 0.0f, max = 0.0f;  // 1.0 = the whole deadline
+        juce::uint64 numXrunRisks = 0, numOverruns = 0;
+        std::array<double, maxStages> stageAverageMicroseconds{};
+    };
+
+    DspLoadMeter() = default;
+
+    void prepare(double sampleRate) noexcept;
+
+    // message thread, clears everything measured so far
+    void reset() noexcept;
+
+    void setStageTimingEnabled(bool shouldTime) noexcept { stageTimingEnabled.store(shouldTime); }
+    bool isStageTimingEnabled() const noexcept { return stageTimingEnabled.load(std::memory_order_relaxed); }
+
+    //==============================================================================
+    // audio thread
+    juce::int64 beginBlock() const noexcept { return juce::Time::getHighResolutionTicks(); }
+    void endBlock(juce::int64 startTicks, int numSamples) noexcept;
+
+    template <typename Function>
+    void measureStage(int stage, Function&& function) noexcept
+    {
+        if (! isStageTimingEnabled())
+        {
+            function();
+            return;
+        }
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        function();
+        addStageTicks(stage, juce::Time::getHighResolutionTicks() - start);
+    }
+
+    //==============================================================================
+    // message thread
+    Snapshot getSnapshot() const noexcept;
+
+    // the last historySize block loads, oldest first
+    void copyHistory(std::array<float, historySize>& destination) const noexcept;
+
+    // stats and the whole histogram as JSON, stageNames label the stage columns
+    bool exportToFile(const juce::File& file, const juce::StringArray& stageNames) const;
+
+private:
+    // 0.5% wide bins up to twice the deadline, the last one catches everything above
+    static constexpr int numBins = 401;
+    static constexpr float binsPerUnit = 200.0f;
+
+    void addStageTicks(int stage, juce::int64 ticks) noexcept;
+
+    double ticksPerSample = 0.0;
+    std::atomic<bool> stageTimingEnabled{ false };
+
+    std::array<std::atomic<juce::uint32>, numBins> histogram{};
+    std::atomic<float> maxLoad{ 0.0f };
+    std::atomic<juce::uint64> numXrunRisks{ 0 }, numOverruns{ 0 };
+
+    std::array<std::atomic<float>, historySize> history{};
+    std::atomic<int> historyPosition{ 0 };
+
+    std::array<std::atomic<juce::int64>, maxStages> stageTicks{};
+    std::array<std::atomic<juce::uint32>, maxStages> stageCounts{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DspLoadMeter)
+};
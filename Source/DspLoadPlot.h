@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    DspLoadPlot.h
+
+    Plot source for the foleys GUI that draws the recent block loads of a
+    DspLoadMeter, the full height being the whole callback deadline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspLoadMeter.h"
+#include "MeasurementPlot.h"
+
+class DspLoadPlot  : public MeasurementPlot
+{
+public:
+    explicit DspLoadPlot(const DspLoadMeter& meterToShow) : meter(meterToShow) {}
+
+    void createPlotPaths(juce::Path& path, juce::Path& filledPath, juce::Rectangle<float> bounds, foleys::MagicPlotComponent&) override
+    {
+        PlotPaths::addPath(path, loads, bounds, 0.0f, 1.0f);
+
+        filledPath = path;
+        PlotPaths::closeToBottom(filledPath, bounds);
+    }
+
+private:
+    // the meter keeps no frame count, every update repaints
+    bool copyLatest() override
+    {
+        meter.copyHistory(loads);
+        return true;
+    }
+
+    const DspLoadMeter& meter;
+    std::array<float, DspLoadMeter::historySize> loads{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DspLoadPlot)
+};
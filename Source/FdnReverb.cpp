@@ -0,0 +1,312 @@
+/*
+  ==============================================================================
+
+    FdnReverb.cpp
+
+  ==============================================================================
+*/
+
+#include "FdnReverb.h"
+
+namespace
+{
+    constexpr int numLines = FdnReverb::numLines;
+
+    // mutually prime line lengths at 48 kHz, roughly 30 to 58 ms
+    constexpr int lineLengths48k[numLines] = { 1433, 1601, 1867, 2053, 2251, 2399, 2617, 2797 };
+
+    // even lines are fed from the left input, odd lines from the right
+    alignas(32) constexpr float inputSigns[numLines] = { 1.f, 1.f, -1.f, 1.f, 1.f, -1.f, -1.f, -1.f };
+
+    // two orthogonal tap patterns, so the outputs come out decorrelated
+    alignas(32) constexpr float leftOutputSigns[numLines] = { 1.f, -1.f, 1.f, -1.f, 1.f, -1.f, 1.f, -1.f };
+    alignas(32) constexpr float rightOutputSigns[numLines] = { 1.f, 1.f, -1.f, -1.f, -1.f, -1.f, 1.f, 1.f };
+
+    // roomSize 0..1 maps to a decay of 0.3..8 seconds
+    double getRT60(const FdnReverb::Parameters& params) noexcept
+    {
+        return 0.3 + 7.7 * (double)(params.roomSize * params.roomSize);
+    }
+
+    const float hadamardScale = 1.0f / std::sqrt((float)numLines);
+    constexpr float outputScale = 0.5f; // roughly level-matched to FreeverbCore at the same wetLevel
+    constexpr float wetScaleFactor = 3.0f;
+    constexpr float dryScaleFactor = 2.0f;
+
+    //==============================================================================
+    // x = H8 * x / sqrt(8), as an in-place fast Walsh-Hadamard transform
+    inline void hadamardScalar(float* x) noexcept
+    {
+        for (int span = 1; span < numLines; span *= 2)
+            for (int i = 0; i < numLines; i += 2 * span)
+                for (int j = i; j < i + span; ++j)
+                {
+                    const auto a = x[j], b = x[j + span];
+                    x[j] = a + b;
+                    x[j + span] = a - b;
+                }
+
+        for (int i = 0; i < numLines; ++i)
+            x[i] *= hadamardScale;
+    }
+
+   #if JUCE_USE_SIMD
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    // samples per register, the block the SIMD path works through at a time
+    constexpr int blockSize = (int)Vec::SIMDNumElements;
+   #endif
+}
+
+//==============================================================================
+FdnReverb::FdnReverb()
+{
+    setParameters(Parameters());
+}
+
+void FdnReverb::setParameters(const Parameters& newParams)
+{
+    const float wet = newParams.wetLevel * wetScaleFactor * outputScale;
+    dryGain.setTargetValue(newParams.dryLevel * dryScaleFactor);
+    wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+    wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+    parameters = newParams;
+    updateLineGains();
+}
+
+void FdnReverb::updateLineGains() noexcept
+{
+    if (parameters.freezeMode >= 0.5f)
+    {
+        damp = 0.0f;
+        inputGain = 0.0f;
+
+        for (auto& g : lineGains)
+            g = 1.0f;
+
+        designedRt60 = 0.0;
+        return;
+    }
+
+    // called every chain update, the pow()s only when the decay actually changed
+    const auto rt60 = getRT60(parameters);
+
+    if (! juce::approximatelyEqual(rt60, designedRt60))
+    {
+        for (int i = 0; i < numLines; ++i)
+            lineGains[i] = (float)std::pow(10.0, -3.0 * delayLengths[(size_t)i] / (rt60 * sampleRate));
+
+        designedRt60 = rt60;
+    }
+
+    damp = parameters.damping * 0.6f;
+    inputGain = 0.25f;
+}
+
+//==============================================================================
+void FdnReverb::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
+
+    int longest = 0;
+
+    for (int i = 0; i < numLines; ++i)
+    {
+        delayLengths[(size_t)i] = juce::jmax(1, (int)std::round(lineLengths48k[i] * sampleRate / 48000.0));
+        longest = juce::jmax(longest, delayLengths[(size_t)i]);
+    }
+
+    const auto ringSize = juce::nextPowerOfTwo(longest + 1);
+    ringMask = ringSize - 1;
+
+    // a whole frame of 8 floats is 32 bytes, so keep the base on that boundary
+    ring.allocate((size_t)(ringSize * numLines + 8), true);
+    lines = juce::snapPointerToAlignment(ring.get(), 32);
+
+    const double smoothTime = 0.01;
+    dryGain.reset(sampleRate, smoothTime);
+    wetGain1.reset(sampleRate, smoothTime);
+    wetGain2.reset(sampleRate, smoothTime);
+
+    // the line lengths changed with the rate
+    designedRt60 = 0.0;
+    updateLineGains();
+    reset();
+}
+
+void FdnReverb::reset() noexcept
+{
+    if (lines != nullptr)
+        juce::zeromem(lines, (size_t)(ringMask + 1) * numLines * sizeof(float));
+
+    juce::zeromem(dampingState, sizeof(dampingState));
+    writePosition = 0;
+}
+
+size_t FdnReverb::getMemoryFootprintBytes() const noexcept
+{
+    return sizeof(*this) + (lines != nullptr ? (size_t)(ringMask + 1) * numLines * sizeof(float) : 0);
+}
+
+double FdnReverb::getTailSeconds(const Parameters& params) noexcept
+{
+    if (params.freezeMode >= 0.5f)
+        return std::numeric_limits<double>::infinity();
+
+    // 120 dB is two RT60s, plus the longest line still to play out
+    return 2.0 * getRT60(params) + lineLengths48k[numLines - 1] / 48000.0;
+}
+
+//==============================================================================
+void FdnReverb::processSamples(float* left, float* right, int numSamples) noexcept
+{
+    jassert(lines != nullptr); // prepare() hasn't been called
+
+    int n = 0;
+
+   #if JUCE_USE_SIMD
+    // A register holds one line over blockSize consecutive samples. Every line is longer
+    // than that, so a block's taps are all read before any of its samples is written, and
+    // the Hadamard butterflies become adds and subtracts of whole registers, done in the
+    // same order as hadamardScalar so both paths round alike.
+    if (delayLengths[0] >= blockSize)
+    {
+        const auto scale = Vec::expand(hadamardScale);
+
+        for (; n + blockSize <= numSamples; n += blockSize)
+        {
+            alignas(32) float blockTaps[numLines][blockSize];
+            alignas(32) float blockLines[numLines][blockSize];
+            alignas(32) float inLeft[blockSize], inRight[blockSize], outLeft[blockSize], outRight[blockSize];
+
+            for (int s = 0; s < blockSize; ++s)
+            {
+                inLeft[s] = left[n + s];
+                inRight[s] = right != nullptr ? right[n + s] : inLeft[s];
+            }
+
+            // the damping filter runs along each line
+            for (int i = 0; i < numLines; ++i)
+            {
+                auto state = dampingState[i];
+
+                for (int s = 0; s < blockSize; ++s)
+                {
+                    const auto tap = lines[(size_t)((writePosition + s - delayLengths[(size_t)i]) & ringMask) * numLines + (size_t)i];
+                    blockTaps[i][s] = tap;
+
+                    state = tap * (1.0f - damp) + state * damp;
+                    juce::dsp::util::snapToZero(state);
+                    blockLines[i][s] = state * lineGains[i];
+                }
+
+                dampingState[i] = state;
+            }
+
+            Vec x[numLines];
+
+            for (int i = 0; i < numLines; ++i)
+                x[i] = Vec::fromRawArray(blockLines[i]);
+
+            for (int span = 1; span < numLines; span *= 2)
+                for (int i = 0; i < numLines; i += 2 * span)
+                    for (int j = i; j < i + span; ++j)
+                    {
+                        const auto a = x[j], b = x[j + span];
+                        x[j] = a + b;
+                        x[j + span] = a - b;
+                    }
+
+            const auto leftIn = Vec::fromRawArray(inLeft), rightIn = Vec::fromRawArray(inRight);
+            auto leftOut = Vec::fromRawArray(blockTaps[0]) * leftOutputSigns[0];
+            auto rightOut = Vec::fromRawArray(blockTaps[0]) * rightOutputSigns[0];
+
+            for (int i = 0; i < numLines; ++i)
+            {
+                const auto in = (i & 1) == 0 ? leftIn : rightIn;
+                (x[i] * scale + Vec::expand(inputSigns[i] * inputGain) * in).copyToRawArray(blockLines[i]);
+
+                if (i > 0)
+                {
+                    const auto tap = Vec::fromRawArray(blockTaps[i]);
+                    leftOut += tap * leftOutputSigns[i];
+                    rightOut += tap * rightOutputSigns[i];
+                }
+            }
+
+            leftOut.copyToRawArray(outLeft);
+            rightOut.copyToRawArray(outRight);
+
+            for (int s = 0; s < blockSize; ++s)
+            {
+                auto* frame = lines + (size_t)((writePosition + s) & ringMask) * numLines;
+
+                for (int i = 0; i < numLines; ++i)
+                    frame[i] = blockLines[i][s];
+
+                const auto dry = dryGain.getNextValue();
+                const auto wet1 = wetGain1.getNextValue();
+                const auto wet2 = wetGain2.getNextValue();
+
+                if (right != nullptr)
+                {
+                    left[n + s] = outLeft[s] * wet1 + outRight[s] * wet2 + inLeft[s] * dry;
+                    right[n + s] = outRight[s] * wet1 + outLeft[s] * wet2 + inRight[s] * dry;
+                }
+                else
+                {
+                    left[n + s] = outLeft[s] * wet1 + inLeft[s] * dry;
+                }
+            }
+
+            writePosition = (writePosition + blockSize) & ringMask;
+        }
+    }
+   #endif
+
+    // what is left of the block, or all of it without SIMD
+    for (; n < numSamples; ++n)
+    {
+        const auto inLeft = left[n];
+        const auto inRight = right != nullptr ? right[n] : inLeft;
+        auto* frame = lines + (size_t)(writePosition & ringMask) * numLines;
+
+        for (int i = 0; i < numLines; ++i)
+            taps[i] = lines[(size_t)((writePosition - delayLengths[(size_t)i]) & ringMask) * numLines + (size_t)i];
+
+        float outLeft = 0.0f, outRight = 0.0f;
+
+        for (int i = 0; i < numLines; ++i)
+        {
+            dampingState[i] = taps[i] * (1.0f - damp) + dampingState[i] * damp;
+            juce::dsp::util::snapToZero(dampingState[i]);
+            mixed[i] = dampingState[i] * lineGains[i];
+        }
+
+        hadamardScalar(mixed);
+
+        for (int i = 0; i < numLines; ++i)
+        {
+            frame[i] = mixed[i] + inputSigns[i] * inputGain * ((i & 1) == 0 ? inLeft : inRight);
+            outLeft += taps[i] * leftOutputSigns[i];
+            outRight += taps[i] * rightOutputSigns[i];
+        }
+
+        writePosition = (writePosition + 1) & ringMask;
+
+        const auto dry = dryGain.getNextValue();
+        const auto wet1 = wetGain1.getNextValue();
+        const auto wet2 = wetGain2.getNextValue();
+
+        if (right != nullptr)
+        {
+            left[n] = outLeft * wet1 + outRight * wet2 + inLeft * dry;
+            right[n] = outRight * wet1 + outLeft * wet2 + inRight * dry;
+        }
+        else
+        {
+            left[n] = outLeft * wet1 + inLeft * dry;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    FdnReverb.h
+
+    "Hall" algorithm: an 8 line feedback delay network with a Hadamard
+    feedback matrix and a one-pole damping filter in every line.
+
+    All eight lines share one power-of-two ring buffer, interleaved so the
+    eight writes of a sample are one contiguous store and every read is a
+    masked index instead of a modulo. With SIMD, a register carries one line
+    across consecutive samples, so the Hadamard mix of a whole block is a
+    few register adds and subtracts. Takes the same juce::Reverb::Parameters
+    as FreeverbCore so either can sit in a chain slot.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class FdnReverb
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    static constexpr int numLines = 8;
+
+    FdnReverb();
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return parameters; }
+    void setParameters(const Parameters& newParams);
+
+    bool isEnabled() const noexcept { return enabled; }
+    void setEnabled(bool newValue) noexcept { enabled = newValue; }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numChannels = outputBlock.getNumChannels();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        if (! enabled || context.isBypassed || numChannels == 0)
+            return;
+
+        jassert(numChannels <= 2);
+
+        processSamples(outputBlock.getChannelPointer(0),
+                       numChannels > 1 ? outputBlock.getChannelPointer(1) : nullptr,
+                       (int)outputBlock.getNumSamples());
+    }
+
+    size_t getMemoryFootprintBytes() const noexcept;
+
+    // seconds until the tail is 120 dB down, infinite in freeze mode
+    static double getTailSeconds(const Parameters& params) noexcept;
+
+private:
+    void processSamples(float* left, float* right, int numSamples) noexcept;
+    void updateLineGains() noexcept;
+
+    Parameters parameters;
+    bool enabled = true;
+    double sampleRate = 44100.0;
+
+    // interleaved: sample n of line i lives at ring[(n & mask) * numLines + i]
+    juce::HeapBlock<float> ring;
+    float* lines = nullptr;
+    int ringMask = 0;
+    int writePosition = 0;
+
+    std::array<int, numLines> delayLengths{};
+
+    alignas(32) float lineGains[numLines] = {};
+
+    // the RT60 lineGains were designed for, 0 forces the next update to redo them
+    double designedRt60 = 0.0;
+    alignas(32) float dampingState[numLines] = {};
+    alignas(32) float taps[numLines] = {};
+    alignas(32) float mixed[numLines] = {};
+
+    float damp = 0.0f, inputGain = 0.0f;
+
+    juce::SmoothedValue<float> dryGain, wetGain1, wetGain2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FdnReverb)
+};
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    FeedbackDelay.cpp
+
+  ==============================================================================
+*/
+
+#include "FeedbackDelay.h"
+
+void FeedbackDelay::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    const juce::ScopedLock sl(allocationLock);
+
+    sampleRate = spec.sampleRate;
+    numChannels = (int)spec.numChannels;
+
+    const double smoothTime = 0.05;
+    delaySamples.reset(sampleRate, smoothTime);
+    feedback.reset(sampleRate, smoothTime);
+    mix.reset(sampleRate, smoothTime);
+
+    if (ready.load() || allocationRequested.load())
+        allocate();
+}
+
+void FeedbackDelay::reset() noexcept
+{
+    if (memory != nullptr)
+        juce::zeromem(memory.get(), (size_t)ringSize * (size_t)numChannels * sizeof(float));
+
+    writePosition = 0;
+}
+
+void FeedbackDelay::releaseMemory()
+{
+    const juce::ScopedLock sl(allocationLock);
+
+    ready.store(false);
+    allocationRequested.store(false);
+    memory.free();
+    ringSize = ringMask = 0;
+    active = false;
+}
+
+void FeedbackDelay::setParameters(float delaySeconds, float feedbackAmount, float mixAmount) noexcept
+{
+    const auto maxDelaySamples = (float)(maximumDelaySeconds * sampleRate);
+    delaySamples.setTargetValue(juce::jlimit(1.0f, juce::jmax(1.0f, maxDelaySamples), delaySeconds * (float)sampleRate));
+    feedback.setTargetValue(feedbackAmount);
+    mix.setTargetValue(mixAmount);
+
+    if (mixAmount > 0.0f && ! ready.load(std::memory_order_acquire))
+        allocationRequested.store(true, std::memory_order_release);
+}
+
+void FeedbackDelay::allocateIfRequested()
+{
+    if (! allocationRequested.load(std::memory_order_acquire) || ready.load())
+        return;
+
+    const juce::ScopedLock sl(allocationLock);
+    allocate();
+}
+
+void FeedbackDelay::allocate()
+{
+    ready.store(false, std::memory_order_release);
+
+    // +2 leaves room for the interpolation neighbour at the longest delay
+    ringSize = juce::nextPowerOfTwo((int)std::ceil(maximumDelaySeconds * sampleRate) + 2);
+    ringMask = ringSize - 1;
+    memory.allocate((size_t)ringSize * (size_t)juce::jmax(1, numChannels), true);
+    writePosition = 0;
+    active = false;
+
+    allocationRequested.store(false);
+    ready.store(true, std::memory_order_release);
+}
+
+size_t FeedbackDelay::getMemoryFootprintBytes() const noexcept
+{
+    return sizeof(*this) + (isAllocated() ? (size_t)ringSize * (size_t)numChannels * sizeof(float) : 0);
+}
+
+double FeedbackDelay::getTailSeconds(float delaySeconds, float feedbackAmount, float mixAmount) noexcept
+{
+    if (mixAmount <= 0.0f)
+        return 0.0;
+
+    if (feedbackAmount >= 1.0f)
+        return std::numeric_limits<double>::infinity();
+
+    // the first echo plus as many repeats as it takes to fall 120 dB
+    const auto repeats = feedbackAmount > 0.0f ? std::log(1.0e-6) / std::log((double)feedbackAmount) : 0.0;
+    return delaySeconds * (1.0 + repeats);
+}
+
+//==============================================================================
+void FeedbackDelay::processSamples(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    const auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+    const auto numSamples = (int)block.getNumSamples();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto delay = delaySamples.getNextValue();
+        const auto fb = feedback.getNextValue();
+        const auto wet = mix.getNextValue();
+
+        const auto whole = (int)delay;
+        const auto fraction = delay - (float)whole;
+        const auto readA = (writePosition - whole) & ringMask;
+        const auto readB = (readA - 1) & ringMask;
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            auto* ring = memory.get() + (size_t)ch * (size_t)ringSize;
+            auto* samples = block.getChannelPointer((size_t)ch);
+
+            const auto delayed = ring[readA] + fraction * (ring[readB] - ring[readA]);
+            auto recirculated = samples[i] + delayed * fb;
+            juce::dsp::util::snapToZero(recirculated);
+
+            ring[writePosition] = recirculated;
+            samples[i] += delayed * wet;
+        }
+
+        writePosition = (writePosition + 1) & ringMask;
+    }
+}
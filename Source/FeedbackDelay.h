@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    FeedbackDelay.h
+
+    Feedback delay in front of the reverbs. Its ring buffer is sized from
+    the longest delay time in seconds and only exists once the delay has
+    actually been turned up: the audio thread asks for it, and the message
+    thread allocates it and hands it over. Until then the stage is a no-op
+    that costs no memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class FeedbackDelay
+{
+public:
+    FeedbackDelay() = default;
+
+    // longest delay the buffer has to hold, takes effect on the next allocation
+    void setMaximumDelaySeconds(double newMaximum) noexcept { maximumDelaySeconds = newMaximum; }
+    double getMaximumDelaySeconds() const noexcept { return maximumDelaySeconds; }
+
+    /** Keeps the buffer if there already is one (resized for the new spec),
+        otherwise stays unallocated until the delay is enabled.
+    */
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    // drops the buffer, the next enable allocates again
+    void releaseMemory();
+
+    // audio thread, a mix above zero enables the stage
+    void setParameters(float delaySeconds, float feedbackAmount, float mixAmount) noexcept;
+
+    // message thread, call regularly: allocates the buffer once the audio thread asked for one
+    void allocateIfRequested();
+
+    bool isAllocated() const noexcept { return ready.load(std::memory_order_acquire); }
+
+    size_t getMemoryFootprintBytes() const noexcept;
+
+    // seconds until the repeats are 120 dB down, 0 while the mix is off
+    static double getTailSeconds(float delaySeconds, float feedbackAmount, float mixAmount) noexcept;
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        auto& outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(context.getInputBlock());
+
+        if (context.isBypassed || ! isAllocated())
+            return;
+
+        if (! mix.isSmoothing() && mix.getTargetValue() <= 0.0f)
+        {
+            active = false;
+            return;
+        }
+
+        if (! active)
+        {
+            // whatever was left in the ring is from before the delay was switched off,
+            // and the time shouldn't glide in from wherever it was back then
+            reset();
+            delaySamples.setCurrentAndTargetValue(delaySamples.getTargetValue());
+            active = true;
+        }
+
+        processSamples(outputBlock);
+    }
+
+private:
+    void allocate();
+    void processSamples(const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    juce::CriticalSection allocationLock;
+    juce::HeapBlock<float> memory;
+    int ringSize = 0, ringMask = 0;
+    int numChannels = 0;
+    double sampleRate = 44100.0;
+    double maximumDelaySeconds = 5.0;
+
+    std::atomic<bool> ready{ false }, allocationRequested{ false };
+    bool active = false;
+    int writePosition = 0;
+
+    juce::SmoothedValue<float> delaySamples, feedback, mix;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FeedbackDelay)
+};
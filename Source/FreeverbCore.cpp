@@ -0,0 +1,500 @@
+/*
+  ==============================================================================
+
+    FreeverbCore.cpp
+
+  ==============================================================================
+*/
+
+#include "FreeverbCore.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+
+ #if JUCE_GCC || JUCE_CLANG
+  #define MARS_AVX_TARGET __attribute__((target("avx")))
+ #else
+  #define MARS_AVX_TARGET
+ #endif
+#endif
+
+namespace
+{
+    // Freeverb tunings at 44.1 kHz, identical to juce::Reverb
+    constexpr short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+    constexpr short allPassTunings[] = { 556, 441, 341, 225 };
+    constexpr int stereoSpread = 23;
+
+    constexpr int numCombs = FreeverbCore::numCombs;
+    constexpr int numCombLanes = FreeverbCore::numCombLanes;
+
+    //==============================================================================
+    // The comb update for one chunk. taps/writes hold numCombLanes values per sample,
+    // a tap is what the comb reads back and a write is what goes into its delay.
+    void processCombLanesScalar(const float* taps, float* writes, float* last,
+                                const float* input, const float* damp, const float* feedback,
+                                float* outLeft, float* outRight, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto* tap = taps + i * numCombLanes;
+            auto* write = writes + i * numCombLanes;
+            float sumLeft = 0, sumRight = 0;
+
+            for (int lane = 0; lane < numCombLanes; ++lane)
+            {
+                last[lane] = tap[lane] * (1.0f - damp[i]) + last[lane] * damp[i];
+                write[lane] = input[i] + last[lane] * feedback[i];
+            }
+
+            for (int lane = 0; lane < numCombs; ++lane)
+            {
+                sumLeft += tap[lane];
+                sumRight += tap[numCombs + lane];
+            }
+
+            outLeft[i] = sumLeft;
+            outRight[i] = sumRight;
+        }
+    }
+
+   #if JUCE_USE_SIMD
+    void processCombLanesSIMD(const float* taps, float* writes, float* last,
+                              const float* input, const float* damp, const float* feedback,
+                              float* outLeft, float* outRight, int numSamples)
+    {
+        using Vec = juce::dsp::SIMDRegister<float>;
+        constexpr int regsPerSide = numCombs / (int)Vec::SIMDNumElements;
+        static_assert(numCombs % Vec::SIMDNumElements == 0, "comb lanes must fill whole registers");
+
+        Vec lastLanes[2 * regsPerSide];
+
+        for (int r = 0; r < 2 * regsPerSide; ++r)
+            lastLanes[r] = Vec::fromRawArray(last + r * Vec::SIMDNumElements);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto* tap = taps + i * numCombLanes;
+            auto* write = writes + i * numCombLanes;
+
+            const auto in = Vec::expand(input[i]);
+            const auto d = Vec::expand(damp[i]);
+            const auto oneMinusD = Vec::expand(1.0f - damp[i]);
+            const auto fb = Vec::expand(feedback[i]);
+
+            auto sumLeft = Vec::expand(0.0f), sumRight = Vec::expand(0.0f);
+
+            for (int r = 0; r < 2 * regsPerSide; ++r)
+            {
+                const auto t = Vec::fromRawArray(tap + r * Vec::SIMDNumElements);
+                lastLanes[r] = t * oneMinusD + lastLanes[r] * d;
+                (in + lastLanes[r] * fb).copyToRawArray(write + r * Vec::SIMDNumElements);
+
+                if (r < regsPerSide)
+                    sumLeft += t;
+                else
+                    sumRight += t;
+            }
+
+            outLeft[i] = sumLeft.sum();
+            outRight[i] = sumRight.sum();
+        }
+
+        for (int r = 0; r < 2 * regsPerSide; ++r)
+            lastLanes[r].copyToRawArray(last + r * Vec::SIMDNumElements);
+    }
+   #endif
+
+   #if JUCE_INTEL
+    MARS_AVX_TARGET inline float horizontalSum(__m256 v)
+    {
+        auto sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+
+    // one register holds all eight combs of a side
+    MARS_AVX_TARGET void processCombLanesAVX(const float* taps, float* writes, float* last,
+                                             const float* input, const float* damp, const float* feedback,
+                                             float* outLeft, float* outRight, int numSamples)
+    {
+        static_assert(numCombs == 8, "the AVX kernel assumes one register per side");
+
+        auto lastLeft = _mm256_load_ps(last);
+        auto lastRight = _mm256_load_ps(last + 8);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto* tap = taps + i * numCombLanes;
+            auto* write = writes + i * numCombLanes;
+
+            const auto in = _mm256_set1_ps(input[i]);
+            const auto d = _mm256_set1_ps(damp[i]);
+            const auto oneMinusD = _mm256_set1_ps(1.0f - damp[i]);
+            const auto fb = _mm256_set1_ps(feedback[i]);
+
+            const auto tapLeft = _mm256_load_ps(tap);
+            const auto tapRight = _mm256_load_ps(tap + 8);
+
+            lastLeft = _mm256_add_ps(_mm256_mul_ps(tapLeft, oneMinusD), _mm256_mul_ps(lastLeft, d));
+            lastRight = _mm256_add_ps(_mm256_mul_ps(tapRight, oneMinusD), _mm256_mul_ps(lastRight, d));
+
+            _mm256_store_ps(write, _mm256_add_ps(in, _mm256_mul_ps(lastLeft, fb)));
+            _mm256_store_ps(write + 8, _mm256_add_ps(in, _mm256_mul_ps(lastRight, fb)));
+
+            outLeft[i] = horizontalSum(tapLeft);
+            outRight[i] = horizontalSum(tapRight);
+        }
+
+        _mm256_store_ps(last, lastLeft);
+        _mm256_store_ps(last + 8, lastRight);
+    }
+   #endif
+
+    // Delays are all longer than a chunk, so within one chunk every sample of an
+    // all-pass is independent and the loop vectorises over time. What goes back
+    // into the buffer is snapped to zero so a dying tail never turns denormal.
+    void processAllPass(float* data, float* samples, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto bufferedValue = data[i];
+            auto stored = samples[i] + bufferedValue * 0.5f;
+            juce::dsp::util::snapToZero(stored);
+
+            data[i] = stored;
+            samples[i] = bufferedValue - samples[i];
+        }
+    }
+
+    int roundUpToMultipleOf8(int n) noexcept
+    {
+        return (n + 7) & ~7;
+    }
+}
+
+//==============================================================================
+FreeverbCore::FreeverbCore()
+{
+    selectKernel(getBestKernel());
+    setParameters(Parameters());
+}
+
+void FreeverbCore::setParameters(const Parameters& newParams)
+{
+    const float wetScaleFactor = 3.0f;
+    const float dryScaleFactor = 2.0f;
+
+    const float wet = newParams.wetLevel * wetScaleFactor;
+    dryGain.setTargetValue(newParams.dryLevel * dryScaleFactor);
+    wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+    wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+    gain = newParams.freezeMode >= 0.5f ? 0.0f : 0.015f;
+    parameters = newParams;
+    updateDamping();
+}
+
+void FreeverbCore::updateDamping() noexcept
+{
+    const float roomScaleFactor = 0.28f;
+    const float roomOffset = 0.7f;
+    const float dampScaleFactor = 0.4f;
+
+    if (parameters.freezeMode >= 0.5f)
+    {
+        damping.setTargetValue(0.0f);
+        feedback.setTargetValue(1.0f);
+    }
+    else
+    {
+        damping.setTargetValue(parameters.damping * dampScaleFactor);
+        feedback.setTargetValue(parameters.roomSize * roomScaleFactor + roomOffset);
+    }
+}
+
+//==============================================================================
+void FreeverbCore::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    const auto intSampleRate = (int)spec.sampleRate;
+
+    std::array<int, numCombLanes> combSizes;
+    std::array<int, 2 * numAllPasses> allPassSizes;
+
+    for (int i = 0; i < numCombs; ++i)
+    {
+        combSizes[(size_t)i] = (intSampleRate * combTunings[i]) / 44100;
+        combSizes[(size_t)(numCombs + i)] = (intSampleRate * (combTunings[i] + stereoSpread)) / 44100;
+    }
+
+    for (int i = 0; i < numAllPasses; ++i)
+    {
+        allPassSizes[(size_t)i] = (intSampleRate * allPassTunings[i]) / 44100;
+        allPassSizes[(size_t)(numAllPasses + i)] = (intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100;
+    }
+
+    // every line starts on a 32 byte boundary inside the one arena
+    size_t totalSize = 0;
+
+    for (auto size : combSizes)
+        totalSize += (size_t)roundUpToMultipleOf8(size);
+
+    for (auto size : allPassSizes)
+        totalSize += (size_t)roundUpToMultipleOf8(size);
+
+    arena.allocate(totalSize + 8, true);
+    arenaSize = totalSize + 8;
+
+    auto* next = juce::snapPointerToAlignment(arena.get(), 32);
+
+    for (size_t i = 0; i < combs.size(); ++i)
+    {
+        combs[i] = { next, juce::jmax(1, combSizes[i]), 0 };
+        next += roundUpToMultipleOf8(combSizes[i]);
+    }
+
+    for (size_t i = 0; i < allPasses.size(); ++i)
+    {
+        allPasses[i] = { next, juce::jmax(1, allPassSizes[i]), 0 };
+        next += roundUpToMultipleOf8(allPassSizes[i]);
+    }
+
+    const double smoothTime = 0.01;
+    damping.reset(spec.sampleRate, smoothTime);
+    feedback.reset(spec.sampleRate, smoothTime);
+    dryGain.reset(spec.sampleRate, smoothTime);
+    wetGain1.reset(spec.sampleRate, smoothTime);
+    wetGain2.reset(spec.sampleRate, smoothTime);
+
+    reset();
+}
+
+void FreeverbCore::reset() noexcept
+{
+    if (arena != nullptr)
+        juce::zeromem(arena.get(), arenaSize * sizeof(float));
+
+    for (auto& line : combs)
+        line.index = 0;
+
+    for (auto& line : allPasses)
+        line.index = 0;
+
+    juce::zeromem(combLast, sizeof(combLast));
+}
+
+//==============================================================================
+void FreeverbCore::selectKernel(Kernel newKernel) noexcept
+{
+    kernel = newKernel;
+
+    switch (newKernel)
+    {
+       #if JUCE_INTEL
+        case Kernel::avx:    combKernel = processCombLanesAVX; return;
+       #endif
+       #if JUCE_USE_SIMD
+        case Kernel::simd:   combKernel = processCombLanesSIMD; return;
+       #endif
+        default:             break;
+    }
+
+    kernel = Kernel::scalar;
+    combKernel = processCombLanesScalar;
+}
+
+FreeverbCore::Kernel FreeverbCore::getBestKernel() noexcept
+{
+   #if JUCE_INTEL
+    if (juce::SystemStats::hasAVX())
+        return Kernel::avx;
+   #endif
+
+   #if JUCE_USE_SIMD
+    return Kernel::simd;
+   #else
+    return Kernel::scalar;
+   #endif
+}
+
+size_t FreeverbCore::getMemoryFootprintBytes() const noexcept
+{
+    return sizeof(*this) + arenaSize * sizeof(float);
+}
+
+double FreeverbCore::getTailSeconds(const Parameters& params) noexcept
+{
+    if (params.freezeMode >= 0.5f)
+        return std::numeric_limits<double>::infinity();
+
+    // the longest comb loses (1 - feedback) per trip, damping only makes it faster
+    const auto feedbackLevel = (double)params.roomSize * 0.28 + 0.7;
+    const auto longestComb = (combTunings[numCombs - 1] + stereoSpread) / 44100.0;
+
+    double allPassDelay = 0.0;
+
+    for (auto tuning : allPassTunings)
+        allPassDelay += (tuning + stereoSpread) / 44100.0;
+
+    return std::log(1.0e-6) / std::log(feedbackLevel) * longestComb + allPassDelay;
+}
+
+//==============================================================================
+void FreeverbCore::processSamples(float* left, float* right, int numSamples) noexcept
+{
+    jassert(arena != nullptr); // prepare() hasn't been called
+
+    for (int start = 0; start < numSamples;)
+    {
+        // a chunk never runs over the wrap point of any delay line
+        auto n = juce::jmin(chunkSize, numSamples - start);
+
+        for (auto& line : combs)
+            n = juce::jmin(n, line.size - line.index);
+
+        for (auto& line : allPasses)
+            n = juce::jmin(n, line.size - line.index);
+
+        auto* l = left + start;
+        auto* r = right != nullptr ? right + start : nullptr;
+
+        for (int i = 0; i < n; ++i)
+        {
+            input[i] = (r != nullptr ? l[i] + r[i] : l[i]) * gain;
+            damp[i] = damping.getNextValue();
+            feedbackLevel[i] = feedback.getNextValue();
+        }
+
+        for (int lane = 0; lane < numCombLanes; ++lane)
+        {
+            const auto* tap = combs[(size_t)lane].data + combs[(size_t)lane].index;
+
+            for (int i = 0; i < n; ++i)
+                taps[i * numCombLanes + lane] = tap[i];
+        }
+
+        combKernel(taps, writes, combLast, input, damp, feedbackLevel, outLeft, outRight, n);
+
+        for (auto& last : combLast)
+            juce::dsp::util::snapToZero(last);
+
+        // the damping state is only snapped once per chunk, so every value that goes back
+        // into a comb is snapped on its way in, a dying tail never leaves denormals in the lines
+        for (int lane = 0; lane < numCombLanes; ++lane)
+        {
+            auto& line = combs[(size_t)lane];
+            auto* write = line.data + line.index;
+
+            for (int i = 0; i < n; ++i)
+            {
+                auto stored = writes[i * numCombLanes + lane];
+                juce::dsp::util::snapToZero(stored);
+                write[i] = stored;
+            }
+
+            line.index += n;
+            if (line.index == line.size)
+                line.index = 0;
+        }
+
+        for (int j = 0; j < numAllPasses; ++j)
+        {
+            auto& leftLine = allPasses[(size_t)j];
+            auto& rightLine = allPasses[(size_t)(numAllPasses + j)];
+
+            processAllPass(leftLine.data + leftLine.index, outLeft, n);
+            processAllPass(rightLine.data + rightLine.index, outRight, n);
+
+            for (auto* line : { &leftLine, &rightLine })
+            {
+                line->index += n;
+                if (line->index == line->size)
+                    line->index = 0;
+            }
+        }
+
+        if (r != nullptr)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                const auto dry = dryGain.getNextValue();
+                const auto wet1 = wetGain1.getNextValue();
+                const auto wet2 = wetGain2.getNextValue();
+
+                l[i] = outLeft[i] * wet1 + outRight[i] * wet2 + l[i] * dry;
+                r[i] = outRight[i] * wet1 + outLeft[i] * wet2 + r[i] * dry;
+            }
+        }
+        else
+        {
+            // mono only hears the left comb bank, same as Reverb::processMono
+            for (int i = 0; i < n; ++i)
+            {
+                const auto dry = dryGain.getNextValue();
+                const auto wet1 = wetGain1.getNextValue();
+                wetGain2.getNextValue();
+
+                l[i] = outLeft[i] * wet1 + l[i] * dry;
+            }
+        }
+
+        start += n;
+    }
+}
+
+//==============================================================================
+float FreeverbCore::runNullTest(Kernel kernelToTest, double sampleRate, int numSamples)
+{
+    constexpr int blockSize = 512;
+
+    FreeverbCore reference, candidate;
+    reference.selectKernel(Kernel::scalar);
+    candidate.selectKernel(kernelToTest);
+
+    Parameters params;
+    params.roomSize = 0.8f;
+    params.damping = 0.4f;
+    params.wetLevel = 0.5f;
+    params.dryLevel = 0.3f;
+    params.width = 0.7f;
+
+    for (auto* core : { &reference, &candidate })
+    {
+        core->prepare({ sampleRate, (juce::uint32)blockSize, 2 });
+        core->setParameters(params);
+    }
+
+    juce::AudioBuffer<float> referenceBuffer(2, blockSize), candidateBuffer(2, blockSize);
+    juce::Random random(0x6d617273);
+    float maxError = 0.0f;
+
+    for (int done = 0; done < numSamples; done += blockSize)
+    {
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                referenceBuffer.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+        candidateBuffer.makeCopyOf(referenceBuffer, true);
+
+        juce::dsp::AudioBlock<float> referenceBlock(referenceBuffer), candidateBlock(candidateBuffer);
+        reference.process(juce::dsp::ProcessContextReplacing<float>(referenceBlock));
+        candidate.process(juce::dsp::ProcessContextReplacing<float>(candidateBlock));
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const auto error = std::abs(referenceBuffer.getSample(ch, i) - candidateBuffer.getSample(ch, i));
+
+                // jmax would keep the old value over a NaN
+                if (! std::isfinite(error))
+                    return std::numeric_limits<float>::infinity();
+
+                maxError = juce::jmax(maxError, error);
+            }
+        }
+    }
+
+    return maxError;
+}
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    FreeverbCore.h
+
+    Drop-in replacement for juce::dsp::Reverb. Same Freeverb topology, tunings
+    and Parameters, but the 8 comb filters of both channels are run as 16
+    parallel lanes and all delay memory lives in one aligned arena.
+
+    The lane update is done by a kernel picked at runtime: a plain scalar
+    reference, juce::dsp::SIMDRegister (SSE/NEON, whatever the build targets)
+    or AVX on x86 CPUs that report it. runNullTest() checks a kernel against
+    the scalar reference.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class FreeverbCore
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    enum class Kernel
+    {
+        scalar,
+        simd,
+        avx
+    };
+
+    FreeverbCore();
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return parameters; }
+    void setParameters(const Parameters& newParams);
+
+    bool isEnabled() const noexcept { return enabled; }
+    void setEnabled(bool newValue) noexcept { enabled = newValue; }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numChannels = outputBlock.getNumChannels();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+
+        if (! enabled || context.isBypassed || numChannels == 0)
+            return;
+
+        jassert(numChannels <= 2); // one or two channels, same as juce::dsp::Reverb
+
+        processSamples(outputBlock.getChannelPointer(0),
+                       numChannels > 1 ? outputBlock.getChannelPointer(1) : nullptr,
+                       (int)outputBlock.getNumSamples());
+    }
+
+    //==============================================================================
+    void selectKernel(Kernel newKernel) noexcept;
+    Kernel getKernel() const noexcept { return kernel; }
+
+    // the fastest kernel this CPU can run
+    static Kernel getBestKernel() noexcept;
+
+    size_t getMemoryFootprintBytes() const noexcept;
+
+    // seconds until the tail is 120 dB down, infinite in freeze mode
+    static double getTailSeconds(const Parameters& params) noexcept;
+
+    /** Renders the same noise through the scalar reference and through the
+        given kernel and returns the largest absolute sample difference,
+        infinity if either produced something that isn't finite. MarsRender
+        --check runs it for every kernel the CPU supports.
+    */
+    static float runNullTest(Kernel kernelToTest, double sampleRate = 48000.0, int numSamples = 48000);
+
+    static constexpr int numCombs = 8;
+    static constexpr int numAllPasses = 4;
+    static constexpr int numCombLanes = 2 * numCombs;
+
+private:
+    struct DelayLine
+    {
+        float* data = nullptr;
+        int size = 0;
+        int index = 0;
+    };
+
+    using CombKernel = void (*)(const float* taps, float* writes, float* last,
+                                const float* input, const float* damp, const float* feedback,
+                                float* outLeft, float* outRight, int numSamples);
+
+    // samples handled per pass, bounded by the scratch below
+    static constexpr int chunkSize = 32;
+
+    void processSamples(float* left, float* right, int numSamples) noexcept;
+    void updateDamping() noexcept;
+
+    Parameters parameters;
+    bool enabled = true;
+    float gain = 0.015f;
+
+    // lanes 0-7 are the left combs, 8-15 the right ones
+    std::array<DelayLine, numCombLanes> combs;
+    std::array<DelayLine, 2 * numAllPasses> allPasses;
+
+    juce::HeapBlock<float> arena;
+    size_t arenaSize = 0;
+
+    alignas(32) float combLast[numCombLanes] = {};
+    alignas(32) float taps[chunkSize * numCombLanes] = {};
+    alignas(32) float writes[chunkSize * numCombLanes] = {};
+    alignas(32) float input[chunkSize] = {};
+    alignas(32) float damp[chunkSize] = {};
+    alignas(32) float feedbackLevel[chunkSize] = {};
+    alignas(32) float outLeft[chunkSize] = {};
+    alignas(32) float outRight[chunkSize] = {};
+
+    juce::SmoothedValue<float> damping, feedback, dryGain, wetGain1, wetGain2;
+
+    Kernel kernel = Kernel::scalar;
+    CombKernel combKernel = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FreeverbCore)
+};
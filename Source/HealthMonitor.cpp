@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    HealthMonitor.cpp
+
+  ==============================================================================
+*/
+
+#include "HealthMonitor.h"
+
+bool HealthMonitor::isFinite(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    // NaN and Inf are the only floats with an all-ones exponent, adding one to it
+    // carries into the top bit. OR-ing that over the block needs no compare per sample.
+    constexpr juce::uint32 exponentMask = 0x7f800000, exponentOne = 0x00800000, carry = 0x80000000;
+
+    juce::uint32 flags = 0;
+    const auto numSamples = block.getNumSamples();
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        const auto* samples = block.getChannelPointer(ch);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            juce::uint32 bits;
+            std::memcpy(&bits, samples + i, sizeof(bits));
+            flags |= (bits & exponentMask) + exponentOne;
+        }
+    }
+
+    return (flags & carry) == 0;
+}
+
+juce::uint64 HealthMonitor::getNumTrips(int stage) const noexcept
+{
+    return juce::isPositiveAndBelow(stage, maxStages) ? trips[(size_t)stage].load(std::memory_order_relaxed) : 0;
+}
+
+juce::uint64 HealthMonitor::getTotalTrips() const noexcept
+{
+    juce::uint64 total = 0;
+
+    for (const auto& count : trips)
+        total += count.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+void HealthMonitor::resetTrips() noexcept
+{
+    for (auto& count : trips)
+        count.store(0, std::memory_order_relaxed);
+}
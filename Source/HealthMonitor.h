@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    HealthMonitor.h
+
+    Catches NaN and Inf before they spread. The processor checks each
+    stage's output once per block; a stage that produced non-finite
+    samples has its block silenced and its state reset, the rest of the
+    chain carries on. Trip counts per stage are kept for monitoring.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class HealthMonitor
+{
+public:
+    static constexpr int maxStages = 8;
+
+    HealthMonitor() = default;
+
+    // true if every sample is finite; branch free so the compiler can vectorise it
+    static bool isFinite(const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    /** Audio thread. Returns true if the block is fine, otherwise clears it,
+        counts a trip for the stage and returns false so the caller can reset
+        that stage.
+    */
+    bool check(int stage, juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        if (isFinite(block))
+            return true;
+
+        block.clear();
+
+        if (juce::isPositiveAndBelow(stage, maxStages))
+            trips[(size_t)stage].fetch_add(1, std::memory_order_relaxed);
+
+        return false;
+    }
+
+    juce::uint64 getNumTrips(int stage) const noexcept;
+    juce::uint64 getTotalTrips() const noexcept;
+    void resetTrips() noexcept;
+
+private:
+    std::array<std::atomic<juce::uint64>, maxStages> trips{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HealthMonitor)
+};
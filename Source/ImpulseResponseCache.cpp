@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    ImpulseResponseCache.cpp
+
+  ==============================================================================
+*/
+
+#include "ImpulseResponseCache.h"
+
+namespace
+{
+    // cache files are native-endian and only ever read on the machine that wrote them
+    struct FileHeader
+    {
+        char magic[8];
+        juce::uint32 version;
+        juce::int32 numChannels;
+        juce::int32 length;
+        juce::int32 headSize;
+        juce::int32 tailBlockSize;
+        juce::int32 reserved;
+        double sampleRate;
+        juce::uint64 numFloats;
+        char padding[16];
+    };
+
+    // the spectra start 64 bytes in, which keeps them aligned inside the page-aligned mapping
+    static_assert(sizeof(FileHeader) == 64, "cache header must stay 64 bytes");
+
+    constexpr char headerMagic[8] = { 'M', 'A', 'R', 'S', 'I', 'R', 'S', 0 };
+    constexpr juce::uint32 formatVersion = 2;
+    const char* const fileExtension = ".irspectra";
+}
+
+//==============================================================================
+ImpulseResponseCache::ImpulseResponseCache()
+    : directory(getDefaultDirectory())
+{
+}
+
+juce::String ImpulseResponseCache::makeKey(const juce::MD5& sourceHash, double sampleRate)
+{
+    return sourceHash.toHexString()
+         + "_" + juce::String(juce::roundToInt(sampleRate))
+         + "_" + juce::String(ImpulseResponseSpectra::headSize)
+         + "_" + juce::String(ImpulseResponseSpectra::tailBlockSize);
+}
+
+juce::MD5 ImpulseResponseCache::hashAudio(const juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    juce::MemoryBlock block;
+    block.append(&sampleRate, sizeof(sampleRate));
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        block.append(buffer.getReadPointer(ch), (size_t)buffer.getNumSamples() * sizeof(float));
+
+    return juce::MD5(block);
+}
+
+juce::File ImpulseResponseCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile(JucePlugin_Name)
+               .getChildFile("ImpulseResponseCache");
+}
+
+void ImpulseResponseCache::setDirectory(const juce::File& newDirectory)
+{
+    const juce::ScopedLock sl(lock);
+    directory = newDirectory;
+}
+
+int ImpulseResponseCache::getNumEntries() const
+{
+    const juce::ScopedLock sl(lock);
+    return (int)entries.size();
+}
+
+//==============================================================================
+ImpulseResponseSpectra::Ptr ImpulseResponseCache::find(const juce::String& key)
+{
+    juce::File file;
+
+    {
+        const juce::ScopedLock sl(lock);
+        releaseUnused();
+
+        const auto existing = entries.find(key);
+
+        if (existing != entries.end())
+            return existing->second;
+
+        file = getFileFor(key);
+    }
+
+    auto spectra = readFromDisk(file);
+
+    if (spectra == nullptr)
+        return nullptr;
+
+    const juce::ScopedLock sl(lock);
+    return entries.emplace(key, spectra).first->second;
+}
+
+ImpulseResponseSpectra::Ptr ImpulseResponseCache::add(const juce::String& key, ImpulseResponseSpectra::Ptr spectra)
+{
+    jassert(spectra != nullptr);
+
+    juce::File file;
+
+    {
+        const juce::ScopedLock sl(lock);
+        releaseUnused();
+
+        const auto inserted = entries.emplace(key, spectra);
+
+        if (! inserted.second)
+            return inserted.first->second;
+
+        file = getFileFor(key);
+    }
+
+    // a failed write only costs the next session a rebuild
+    writeToDisk(file, *spectra);
+    return spectra;
+}
+
+void ImpulseResponseCache::releaseUnused()
+{
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->second->getReferenceCount() == 1)
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+juce::File ImpulseResponseCache::getFileFor(const juce::String& key) const
+{
+    return directory.getChildFile(key + fileExtension);
+}
+
+//==============================================================================
+ImpulseResponseSpectra::Ptr ImpulseResponseCache::readFromDisk(const juce::File& file) const
+{
+    if (! file.existsAsFile())
+        return nullptr;
+
+    // the mapping only lives while the spectra are copied out of it, so every page fault
+    // happens here on the loader thread rather than in the audio callback
+    const juce::MemoryMappedFile mappedFile(file, juce::MemoryMappedFile::readOnly);
+    const auto* bytes = static_cast<const char*>(mappedFile.getData());
+    const auto size = mappedFile.getSize();
+
+    if (bytes == nullptr || size < sizeof(FileHeader))
+        return nullptr;
+
+    FileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (std::memcmp(header.magic, headerMagic, sizeof(headerMagic)) != 0
+        || header.version != formatVersion
+        || header.headSize != ImpulseResponseSpectra::headSize
+        || header.tailBlockSize != ImpulseResponseSpectra::tailBlockSize
+        || size != sizeof(FileHeader) + header.numFloats * sizeof(float))
+        return nullptr;
+
+    const auto* data = reinterpret_cast<const float*>(bytes + sizeof(FileHeader));
+
+    return ImpulseResponseSpectra::createFromData(data, (size_t)header.numFloats,
+                                                  header.numChannels, header.length, header.sampleRate);
+}
+
+bool ImpulseResponseCache::writeToDisk(const juce::File& file, const ImpulseResponseSpectra& spectra) const
+{
+    if (! file.getParentDirectory().createDirectory())
+        return false;
+
+    FileHeader header{};
+    std::memcpy(header.magic, headerMagic, sizeof(headerMagic));
+    header.version = formatVersion;
+    header.numChannels = spectra.getNumChannels();
+    header.length = spectra.length;
+    header.headSize = ImpulseResponseSpectra::headSize;
+    header.tailBlockSize = ImpulseResponseSpectra::tailBlockSize;
+    header.sampleRate = spectra.sampleRate;
+    header.numFloats = spectra.getNumFloats();
+
+    // other processes may map the file as soon as it exists, so it only appears complete
+    juce::TemporaryFile temporary(file);
+
+    {
+        juce::FileOutputStream stream(temporary.getFile());
+
+        if (! stream.openedOk()
+            || ! stream.write(&header, sizeof(header))
+            || ! stream.write(spectra.getData(), spectra.getNumFloats() * sizeof(float)))
+            return false;
+
+        stream.flush();
+    }
+
+    return temporary.overwriteTargetFileWithTemporary();
+}
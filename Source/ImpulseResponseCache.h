@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    ImpulseResponseCache.h
+
+    Process-wide store of partitioned impulse responses, shared by every
+    plugin instance through juce::SharedResourcePointer. Entries are keyed
+    by a hash of the source audio, the processing rate and the partition
+    sizes, so the same file loaded into many slots is decoded and
+    transformed once and kept in memory once.
+
+    Every entry is also written to a cache directory. A reopened session
+    reads the spectra back through a juce::MemoryMappedFile instead of
+    rebuilding them, copying them into memory of their own on the loader
+    thread so the audio thread never takes a page fault on the file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include "PartitionedConvolver.h"
+
+class ImpulseResponseCache
+{
+public:
+    ImpulseResponseCache();
+
+    // the same source at the same rate and partition sizes always gives the same key
+    static juce::String makeKey(const juce::MD5& sourceHash, double sampleRate);
+    static juce::MD5 hashAudio(const juce::AudioBuffer<float>& buffer, double sampleRate);
+
+    /** Memory first, then the cache directory. Returns nullptr if neither
+        has it, or if the file on disk doesn't check out.
+    */
+    ImpulseResponseSpectra::Ptr find(const juce::String& key);
+
+    /** Shares newly built spectra and writes them to the cache directory.
+        If another instance added the same key in the meantime, returns
+        that entry instead.
+    */
+    ImpulseResponseSpectra::Ptr add(const juce::String& key, ImpulseResponseSpectra::Ptr spectra);
+
+    static juce::File getDefaultDirectory();
+    void setDirectory(const juce::File& newDirectory);
+
+    int getNumEntries() const;
+
+private:
+    // entries only the cache itself still holds
+    void releaseUnused();
+
+    ImpulseResponseSpectra::Ptr readFromDisk(const juce::File& file) const;
+    bool writeToDisk(const juce::File& file, const ImpulseResponseSpectra& spectra) const;
+    juce::File getFileFor(const juce::String& key) const;
+
+    juce::CriticalSection lock;
+    std::map<juce::String, ImpulseResponseSpectra::Ptr> entries;
+    juce::File directory;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ImpulseResponseCache)
+};
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    LfoBank.cpp
+
+  ==============================================================================
+*/
+
+#include "LfoBank.h"
+
+namespace
+{
+    constexpr int tableSize = 1024;
+    constexpr int numShapes = 3;
+
+    // beats per LFO cycle for each modSync choice, bars counted in 4/4
+    constexpr double syncBeats[] = { 0.0, 16.0, 8.0, 4.0, 2.0, 1.0, 0.5, 0.25 };
+
+    // one cycle per shape plus a guard point, so a lookup never wraps
+    struct Wavetables
+    {
+        Wavetables()
+        {
+            constexpr auto squareDrive = 3.0;
+
+            for (int i = 0; i <= tableSize; ++i)
+            {
+                const auto phase = (double)i / tableSize;
+                const auto sine = std::sin(juce::MathConstants<double>::twoPi * phase);
+
+                tables[(size_t)LfoBank::Shape::sine][(size_t)i] = (float)sine;
+                tables[(size_t)LfoBank::Shape::triangle][(size_t)i] = (float)(1.0 - 4.0 * std::abs(std::fmod(phase + 0.25, 1.0) - 0.5));
+                tables[(size_t)LfoBank::Shape::softSquare][(size_t)i] = (float)(std::tanh(squareDrive * sine) / std::tanh(squareDrive));
+            }
+        }
+
+        const float* get(LfoBank::Shape shape) const noexcept { return tables[(size_t)shape].data(); }
+
+        std::array<std::array<float, tableSize + 1>, numShapes> tables;
+    };
+
+    // built on first use, which prepare() makes sure isn't the audio thread
+    const Wavetables& getWavetables()
+    {
+        static const Wavetables wavetables;
+        return wavetables;
+    }
+
+    inline float lookup(const float* table, double phase) noexcept
+    {
+        const auto position = (float)(phase * tableSize);
+        const auto index = juce::jmin((int)position, tableSize - 1);
+        const auto fraction = position - (float)index;
+
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+}
+
+//==============================================================================
+void LfoBank::prepare(int maximumBlockSize)
+{
+    getWavetables();
+    outputs.setSize((int)numLfos, maximumBlockSize);
+    reset();
+}
+
+void LfoBank::reset() noexcept
+{
+    phases.fill(0.0);
+    phaseErrors.fill(0.0);
+    shapeFade = 0.0;
+    outputs.clear();
+}
+
+void LfoBank::setShape(Shape newShape) noexcept
+{
+    if (newShape == shape)
+        return;
+
+    previousShape = shape;
+    shape = newShape;
+    shapeFade = 1.0;
+}
+
+void LfoBank::setSync(int syncIndex) noexcept
+{
+    beatsPerCycle = syncBeats[juce::jlimit(0, (int)std::size(syncBeats) - 1, syncIndex)];
+}
+
+void LfoBank::setTempo(double newBpm) noexcept
+{
+    if (newBpm > 0.0)
+        bpm = newBpm;
+}
+
+void LfoBank::syncToPosition(double ppqPosition) noexcept
+{
+    if (! isSynced())
+        return;
+
+    const auto cycles = ppqPosition / beatsPerCycle;
+    const auto target = cycles - std::floor(cycles);
+
+    // the shorter way round, between -0.5 and 0.5 of a cycle
+    for (size_t lfo = 0; lfo < numLfos; ++lfo)
+    {
+        const auto error = target - phases[lfo];
+        phaseErrors[lfo] = error - std::floor(error + 0.5);
+    }
+}
+
+float LfoBank::getRate(size_t lfo) const noexcept
+{
+    return isSynced() ? (float)(bpm / (60.0 * beatsPerCycle)) : rates[lfo];
+}
+
+void LfoBank::process(int numSamples, double sampleRate) noexcept
+{
+    jassert(numSamples <= outputs.getNumSamples());
+    numSamples = juce::jmin(numSamples, outputs.getNumSamples());
+
+    if (numSamples <= 0)
+        return;
+
+    const auto& wavetables = getWavetables();
+    const auto* current = wavetables.get(shape);
+    const auto* previous = wavetables.get(previousShape);
+
+    // a share of the phase error goes into this block's increment, the rest waits for the next
+    const auto pull = juce::jmin(1.0, numSamples / (syncGlideSeconds * sampleRate));
+    const auto fadeStep = 1.0 / (shapeFadeSeconds * sampleRate);
+
+    for (size_t lfo = 0; lfo < numLfos; ++lfo)
+    {
+        const auto correction = phaseErrors[lfo] * pull;
+        phaseErrors[lfo] -= correction;
+
+        const auto increment = getRate(lfo) / sampleRate + correction / numSamples;
+        auto* output = outputs.getWritePointer((int)lfo);
+        auto phase = phases[lfo];
+
+        if (shapeFade > 0.0)
+        {
+            auto fade = shapeFade;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto value = lookup(current, phase);
+                output[i] = value + (float)fade * (lookup(previous, phase) - value);
+                fade = juce::jmax(0.0, fade - fadeStep);
+                phase += increment;
+                phase -= std::floor(phase);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                output[i] = lookup(current, phase);
+                phase += increment;
+                phase -= std::floor(phase);
+            }
+        }
+
+        phases[lfo] = phase;
+    }
+
+    shapeFade = juce::jmax(0.0, shapeFade - fadeStep * numSamples);
+}
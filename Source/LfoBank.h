@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    LfoBank.h
+
+    Every LFO of the chain in one place. A call to process() runs them all
+    for the block ahead, each one a phase accumulator reading a wavetable
+    shared by every instance, and the choruses read the results instead of
+    running oscillators of their own.
+
+    Free running, each LFO has its own rate. Synced, they all run at a
+    note length of the host's tempo, and while the transport plays their
+    phase is pulled towards the song position over a few blocks, so a
+    relocation glides instead of stepping the delay time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class LfoBank
+{
+public:
+    // the choice index of the modShape parameter
+    enum class Shape
+    {
+        sine,
+        triangle,
+        softSquare
+    };
+
+    enum Lfo
+    {
+        chorus1Left,
+        chorus1Right,
+        chorus2Left,
+        chorus2Right,
+        numLfos
+    };
+
+    LfoBank() = default;
+
+    // maximumBlockSize at the highest rate process() will be called with
+    void prepare(int maximumBlockSize);
+    void reset() noexcept;
+
+    // switching crossfades from the old shape over shapeFadeSeconds
+    void setShape(Shape newShape) noexcept;
+    void setRate(Lfo lfo, float newRateHz) noexcept { rates[(size_t)lfo] = newRateHz; }
+
+    // the choice index of the modSync parameter, 0 runs free
+    void setSync(int syncIndex) noexcept;
+    bool isSynced() const noexcept { return beatsPerCycle > 0.0; }
+
+    // once per host block, before process()
+    void setTempo(double newBpm) noexcept;
+    void syncToPosition(double ppqPosition) noexcept;
+
+    // fills numSamples values in [-1, 1] per LFO at sampleRate, the rate of whoever reads them
+    void process(int numSamples, double sampleRate) noexcept;
+
+    const float* getOutput(Lfo lfo) const noexcept { return outputs.getReadPointer((int)lfo); }
+
+    static constexpr double shapeFadeSeconds = 0.05;
+
+    // time constant of the pull towards the song position
+    static constexpr double syncGlideSeconds = 0.05;
+
+private:
+    float getRate(size_t lfo) const noexcept;
+
+    Shape shape = Shape::sine, previousShape = Shape::sine;
+    double shapeFade = 0.0;
+
+    std::array<float, numLfos> rates{};
+    std::array<double, numLfos> phases{}, phaseErrors{};
+
+    double beatsPerCycle = 0.0, bpm = 120.0;
+
+    juce::AudioBuffer<float> outputs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfoBank)
+};
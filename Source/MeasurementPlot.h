@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    MeasurementPlot.h
+
+    Base for the plot sources in the foleys GUI that draw what a meter or
+    an analyser measured instead of the audio buffers, plus the path
+    helpers they all draw with.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+namespace PlotPaths
+{
+    // one line through all values, spread evenly from left to right, minimum at the bottom
+    // and maximum at the top; values outside that range are clipped to it
+    template <size_t size>
+    inline void addPath(juce::Path& path, const std::array<float, size>& values, juce::Rectangle<float> bounds,
+                        float minimum, float maximum)
+    {
+        path.clear();
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            const auto x = bounds.getX() + bounds.getWidth() * (float)i / (float)(size - 1);
+            const auto y = juce::jmap(juce::jlimit(minimum, maximum, values[i]), minimum, maximum, bounds.getBottom(), bounds.getY());
+
+            if (i == 0)
+                path.startNewSubPath(x, y);
+            else
+                path.lineTo(x, y);
+        }
+    }
+
+    inline void closeToBottom(juce::Path& path, juce::Rectangle<float> bounds)
+    {
+        path.lineTo(bounds.getBottomRight());
+        path.lineTo(bounds.getBottomLeft());
+        path.closeSubPath();
+    }
+}
+
+//==============================================================================
+class MeasurementPlot  : public foleys::MagicPlotSource
+{
+public:
+    // the data comes from update(), not from the audio buffers
+    void pushSamples(const juce::AudioBuffer<float>&) override {}
+    void prepareToPlay(double, int) override {}
+
+    // message thread, picks up the latest measurement and lets the plot repaint if there was one
+    void update()
+    {
+        if (copyLatest())
+            resetLastDataUpdate();
+    }
+
+protected:
+    // false if nothing changed since the last call
+    virtual bool copyLatest() = 0;
+};
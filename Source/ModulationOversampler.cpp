@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    ModulationOversampler.cpp
+
+  ==============================================================================
+*/
+
+#include "ModulationOversampler.h"
+
+void ModulationOversampler::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    using Oversampling = juce::dsp::Oversampling<float>;
+
+    if (spec.numChannels != numChannels || oversamplers[0] == nullptr)
+    {
+        numChannels = spec.numChannels;
+
+        for (size_t i = 0; i < oversamplers.size(); ++i)
+        {
+            const auto filterType = i < 2 ? Oversampling::filterHalfBandPolyphaseIIR
+                                          : Oversampling::filterHalfBandFIREquiripple;
+
+            // integer latency so the host can compensate it exactly
+            oversamplers[i] = std::make_unique<Oversampling>(numChannels, i % 2 + 1, filterType, true, true);
+        }
+    }
+
+    for (auto& oversampler : oversamplers)
+        oversampler->initProcessing((size_t)spec.maximumBlockSize);
+
+    current = getOversampler(tier, factor);
+    reset();
+}
+
+void ModulationOversampler::reset() noexcept
+{
+    for (auto& oversampler : oversamplers)
+        if (oversampler != nullptr)
+            oversampler->reset();
+}
+
+void ModulationOversampler::setMode(Tier newTier, Factor newFactor) noexcept
+{
+    if (newTier == tier && newFactor == factor)
+        return;
+
+    tier = newTier;
+    factor = newFactor;
+    current = getOversampler(tier, factor);
+
+    // whatever is left in its filters is from the last time it ran
+    if (current != nullptr)
+        current->reset();
+}
+
+int ModulationOversampler::getLatencySamples() const noexcept
+{
+    return getLatencySamples(tier, factor);
+}
+
+int ModulationOversampler::getLatencySamples(Tier tierToCheck, Factor factorToCheck) const noexcept
+{
+    if (auto* oversampler = getOversampler(tierToCheck, factorToCheck))
+        return juce::roundToInt(oversampler->getLatencyInSamples());
+
+    return 0;
+}
+
+juce::dsp::AudioBlock<float> ModulationOversampler::processSamplesUp(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert(current != nullptr);
+    return current->processSamplesUp(block);
+}
+
+void ModulationOversampler::processSamplesDown(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    jassert(current != nullptr);
+    current->processSamplesDown(block);
+}
+
+juce::dsp::Oversampling<float>* ModulationOversampler::getOversampler(Tier tierToFind, Factor factorToFind) const noexcept
+{
+    if (factorToFind == Factor::off)
+        return nullptr;
+
+    return oversamplers[(size_t)tierToFind * 2 + (size_t)factorToFind - 1].get();
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    ModulationOversampler.h
+
+    Optional 2x/4x oversampling around the chorus stages, whose modulated
+    delay lines alias at the base rate once depth and rate are turned up.
+    Realtime playback and offline renders each get their own factor, the
+    realtime tier uses polyphase IIR halfbands and the offline tier linear
+    phase FIR ones. Every combination is built in prepare, so switching
+    while playing never allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <memory>
+
+class ModulationOversampler
+{
+public:
+    enum class Factor
+    {
+        off,
+        twoTimes,
+        fourTimes
+    };
+
+    enum class Tier
+    {
+        realtime, // polyphase IIR, cheap and low latency
+        offline   // equiripple FIR, linear phase
+    };
+
+    ModulationOversampler() = default;
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    // audio thread, an oversampler coming into use starts from silence
+    void setMode(Tier newTier, Factor newFactor) noexcept;
+
+    Tier getTier() const noexcept { return tier; }
+    Factor getFactor() const noexcept { return factor; }
+    bool isActive() const noexcept { return current != nullptr; }
+
+    // latency added at the base rate in whole samples, 0 while off
+    int getLatencySamples() const noexcept;
+    int getLatencySamples(Tier tierToCheck, Factor factorToCheck) const noexcept;
+
+    /** Only valid while isActive(). Returns the upsampled block to run the
+        modulated stages on, processSamplesDown then writes the result back
+        into the base rate block.
+    */
+    juce::dsp::AudioBlock<float> processSamplesUp(const juce::dsp::AudioBlock<float>& block) noexcept;
+    void processSamplesDown(juce::dsp::AudioBlock<float>& block) noexcept;
+
+private:
+    juce::dsp::Oversampling<float>* getOversampler(Tier tierToFind, Factor factorToFind) const noexcept;
+
+    // two factors for each tier, indexed by tier * 2 + factor - 1
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, 4> oversamplers;
+    juce::dsp::Oversampling<float>* current = nullptr;
+    size_t numChannels = 0;
+
+    Tier tier = Tier::realtime;
+    Factor factor = Factor::off;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModulationOversampler)
+};
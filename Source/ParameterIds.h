@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    ParameterIds.h
+
+    The one table of plugin parameters. createParameterLayout builds the apvts
+    from it and ParameterHandles reads back through it, so an ID can't be
+    spelled differently in the two places.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+enum class ParameterId
+{
+    masterHighpass,
+    masterLowpass,
+    reverb1Amount,
+    reverb1Mix,
+    reverb1ModRate,
+    reverb1ModDepth,
+    reverb2Amount,
+    reverb2Mix,
+    reverb2ModRate,
+    reverb2ModDepth,
+    reverb1Algorithm,
+    reverb2Algorithm,
+    dlTime,
+    dlFeedback,
+    dlMix,
+    osRealtime,
+    osRender,
+    filterSlope,
+    dryWetMix,
+    reverbRouting,
+    modShape,
+    modSync,
+
+    numParameters
+};
+
+struct ParameterSpec
+{
+    ParameterId parameter;
+    const char* id;
+    const char* name;
+    float minValue, maxValue, interval, skew;
+    float defaultValue;
+
+    // '|' separated, set for choice parameters whose raw value is the choice index
+    const char* choices = nullptr;
+};
+
+inline constexpr auto numParameters = static_cast<size_t>(ParameterId::numParameters);
+
+//                                                                          min     max       step    skew   default
+inline constexpr std::array<ParameterSpec, numParameters> parameterSpecs{ {
+    { ParameterId::masterHighpass,   "masterHighpass",   "Low Cut",         20.0f,  20000.0f, 1.f,    0.35f, 20000.f },
+    { ParameterId::masterLowpass,    "masterLowpass",    "High Cut",        20.0f,  20000.f,  1.f,    0.35f, 20.f },
+    { ParameterId::reverb1Amount,    "reverb1Amount",    "Rev 1 Amount",    0.05f,  1.f,      0.05f,  1.f,   0.5f },
+    { ParameterId::reverb1Mix,       "reverb1Mix",       "Rev 1 Mix",       0.0f,   1.0f,     0.05f,  1.f,   0.5f },
+    { ParameterId::reverb1ModRate,   "reverb1ModRate",   "Rev 1 Mod Rate",  0.002f, 10.f,     0.005f, 1.f,   0.5f },
+    { ParameterId::reverb1ModDepth,  "reverb1ModDepth",  "Rev 1 ModDepth",  0.0f,   1.0f,     0.05f,  1.f,   0.5f },
+    { ParameterId::reverb2Amount,    "reverb2Amount",    "Rev 2 Amount",    0.05f,  1.f,      0.05f,  1.f,   0.5f },
+    { ParameterId::reverb2Mix,       "reverb2Mix",       "Rev 2 Mix",       0.0f,   1.0f,     0.05f,  1.f,   0.5f },
+    { ParameterId::reverb2ModRate,   "reverb2ModRate",   "Rev 2 Mod Rate",  0.002f, 10.f,     0.005f, 1.f,   0.5f },
+    { ParameterId::reverb2ModDepth,  "reverb2ModDepth",  "Rev 2 ModDepth",  0.0f,   1.0f,     0.05f,  1.f,   0.5f },
+    { ParameterId::reverb1Algorithm, "reverb1Algorithm", "Rev 1 Algorithm", 0.0f,   2.0f,     1.f,    1.f,   0.f, "Classic|Hall|Convolution" },
+    { ParameterId::reverb2Algorithm, "reverb2Algorithm", "Rev 2 Algorithm", 0.0f,   2.0f,     1.f,    1.f,   0.f, "Classic|Hall|Convolution" },
+    { ParameterId::dlTime,           "dlTime",           "Delay Time",      0.1f,   5.0f,     0.1f,   0.5f,  2.f },
+    { ParameterId::dlFeedback,       "dlFeedback",       "Delay Feedback",  0.0f,   0.8f,     0.05f,  1.f,   0.5f },
+    { ParameterId::dlMix,            "dlMix",            "Delay Mix",       0.0f,   1.0f,     0.05f,  1.f,   0.f },
+    { ParameterId::osRealtime,       "osRealtime",       "Mod OS Realtime", 0.0f,   2.0f,     1.f,    1.f,   0.f, "Off|2x|4x" },
+    { ParameterId::osRender,         "osRender",         "Mod OS Render",   0.0f,   2.0f,     1.f,    1.f,   0.f, "Off|2x|4x" },
+    { ParameterId::filterSlope,      "filterSlope",      "Filter Slope",    0.0f,   2.0f,     1.f,    1.f,   0.f, "12 dB|24 dB|48 dB" },
+    { ParameterId::dryWetMix,        "dryWetMix",        "Dry Wet Mix",     0.0f,   1.0f,     0.05f,  1.f,   1.f },
+    { ParameterId::reverbRouting,    "reverbRouting",    "Reverb Routing",  0.0f,   1.0f,     1.f,    1.f,   0.f, "Serial|Parallel" },
+    { ParameterId::modShape,         "modShape",         "Mod Shape",       0.0f,   2.0f,     1.f,    1.f,   0.f, "Sine|Triangle|Soft Square" },
+    { ParameterId::modSync,          "modSync",          "Mod Sync",        0.0f,   7.0f,     1.f,    1.f,   0.f, "Free|4 Bars|2 Bars|1 Bar|1/2|1/4|1/8|1/16" },
+} };
+
+// the table is indexed by ParameterId, so keep the rows in enum order
+constexpr bool parameterSpecsAreInOrder()
+{
+    for (size_t i = 0; i < numParameters; ++i)
+        if (static_cast<size_t>(parameterSpecs[i].parameter) != i)
+            return false;
+
+    return true;
+}
+static_assert(parameterSpecsAreInOrder(), "parameterSpecs rows must follow ParameterId order");
+
+constexpr const ParameterSpec& getParameterSpec(ParameterId parameter)
+{
+    return parameterSpecs[static_cast<size_t>(parameter)];
+}
+
+//==============================================================================
+/** Raw parameter pointers, resolved from the apvts once and then read lock- and
+    lookup-free on the audio thread.
+*/
+struct ParameterHandles
+{
+    explicit ParameterHandles(juce::AudioProcessorValueTreeState& apvts)
+    {
+        for (const auto& spec : parameterSpecs)
+        {
+            values[static_cast<size_t>(spec.parameter)] = apvts.getRawParameterValue(spec.id);
+            jassert(values[static_cast<size_t>(spec.parameter)] != nullptr);
+        }
+    }
+
+    float get(ParameterId parameter) const noexcept
+    {
+        return values[static_cast<size_t>(parameter)]->load(std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<float>*, numParameters> values{};
+};
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    ParameterSmoothing.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterSmoothing.h"
+#include "PluginProcessor.h"
+
+void ChainSmoother::setUpdateInterval(int numSamples) noexcept
+{
+    updateInterval = juce::jmax(1, numSamples);
+}
+
+void ChainSmoother::prepare(double sampleRate, double rampLengthSeconds)
+{
+    for (auto* value : { &reverb1Amount, &reverb1Mix, &reverb1ModDepth, &reverb2Amount, &reverb2Mix, &reverb2ModDepth, &dlTime, &dlFeedback, &dlMix, &masterDryWet, &parallelRouting })
+        value->reset(sampleRate, rampLengthSeconds);
+
+    for (auto* value : { &reverb1ModRate, &reverb2ModRate, &masterHighpass, &masterLowpass })
+        value->reset(sampleRate, rampLengthSeconds);
+}
+
+void ChainSmoother::setCurrentAndTarget(const ChainSettings& settings) noexcept
+{
+    reverb1Amount.setCurrentAndTargetValue(settings.reverb1Amount);
+    reverb1Mix.setCurrentAndTargetValue(settings.reverb1Mix);
+    reverb1ModRate.setCurrentAndTargetValue(settings.reverb1ModRate);
+    reverb1ModDepth.setCurrentAndTargetValue(settings.reverb1ModDepth);
+
+    reverb2Amount.setCurrentAndTargetValue(settings.reverb2Amount);
+    reverb2Mix.setCurrentAndTargetValue(settings.reverb2Mix);
+    reverb2ModRate.setCurrentAndTargetValue(settings.reverb2ModRate);
+    reverb2ModDepth.setCurrentAndTargetValue(settings.reverb2ModDepth);
+
+    masterHighpass.setCurrentAndTargetValue(settings.masterHighpass);
+    masterLowpass.setCurrentAndTargetValue(settings.masterLowpass);
+
+    dlTime.setCurrentAndTargetValue(settings.dlTime);
+    dlFeedback.setCurrentAndTargetValue(settings.dlFeedback);
+    dlMix.setCurrentAndTargetValue(settings.dlMix);
+
+    masterDryWet.setCurrentAndTargetValue(settings.masterDryWet);
+    parallelRouting.setCurrentAndTargetValue(settings.parallelRouting);
+}
+
+void ChainSmoother::setTarget(const ChainSettings& settings) noexcept
+{
+    reverb1Amount.setTargetValue(settings.reverb1Amount);
+    reverb1Mix.setTargetValue(settings.reverb1Mix);
+    reverb1ModRate.setTargetValue(settings.reverb1ModRate);
+    reverb1ModDepth.setTargetValue(settings.reverb1ModDepth);
+
+    reverb2Amount.setTargetValue(settings.reverb2Amount);
+    reverb2Mix.setTargetValue(settings.reverb2Mix);
+    reverb2ModRate.setTargetValue(settings.reverb2ModRate);
+    reverb2ModDepth.setTargetValue(settings.reverb2ModDepth);
+
+    masterHighpass.setTargetValue(settings.masterHighpass);
+    masterLowpass.setTargetValue(settings.masterLowpass);
+
+    dlTime.setTargetValue(settings.dlTime);
+    dlFeedback.setTargetValue(settings.dlFeedback);
+    dlMix.setTargetValue(settings.dlMix);
+
+    masterDryWet.setTargetValue(settings.masterDryWet);
+    parallelRouting.setTargetValue(settings.parallelRouting);
+}
+
+bool ChainSmoother::isSmoothing() const noexcept
+{
+    return reverb1Amount.isSmoothing() || reverb1Mix.isSmoothing()
+        || reverb1ModRate.isSmoothing() || reverb1ModDepth.isSmoothing()
+        || reverb2Amount.isSmoothing() || reverb2Mix.isSmoothing()
+        || reverb2ModRate.isSmoothing() || reverb2ModDepth.isSmoothing()
+        || masterHighpass.isSmoothing() || masterLowpass.isSmoothing()
+        || dlTime.isSmoothing() || dlFeedback.isSmoothing() || dlMix.isSmoothing()
+        || masterDryWet.isSmoothing() || parallelRouting.isSmoothing();
+}
+
+void ChainSmoother::advance(int numSamples, ChainSettings& settings) noexcept
+{
+    // skip() returns the value reached after numSamples steps
+    settings.reverb1Amount = reverb1Amount.skip(numSamples);
+    settings.reverb1Mix = reverb1Mix.skip(numSamples);
+    settings.reverb1ModRate = reverb1ModRate.skip(numSamples);
+    settings.reverb1ModDepth = reverb1ModDepth.skip(numSamples);
+
+    settings.reverb2Amount = reverb2Amount.skip(numSamples);
+    settings.reverb2Mix = reverb2Mix.skip(numSamples);
+    settings.reverb2ModRate = reverb2ModRate.skip(numSamples);
+    settings.reverb2ModDepth = reverb2ModDepth.skip(numSamples);
+
+    settings.masterHighpass = masterHighpass.skip(numSamples);
+    settings.masterLowpass = masterLowpass.skip(numSamples);
+
+    settings.dlTime = dlTime.skip(numSamples);
+    settings.dlFeedback = dlFeedback.skip(numSamples);
+    settings.dlMix = dlMix.skip(numSamples);
+
+    settings.masterDryWet = masterDryWet.skip(numSamples);
+    settings.parallelRouting = parallelRouting.skip(numSamples);
+}
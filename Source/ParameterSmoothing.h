@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    ParameterSmoothing.h
+
+    Ramps every chain parameter towards the latest host value so automation
+    doesn't step once per block. The chain is then updated every
+    updateInterval samples from the ramped values, which keeps the cost of
+    re-applying settings bounded no matter how big the host buffer is.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct ChainSettings;
+
+class ChainSmoother
+{
+public:
+    ChainSmoother() = default;
+
+    // samples between two chain updates, clamped to at least 1
+    void setUpdateInterval(int numSamples) noexcept;
+    int getUpdateInterval() const noexcept { return updateInterval; }
+
+    void prepare(double sampleRate, double rampLengthSeconds = 0.05);
+
+    // jumps straight to these values, used after prepare and on reset
+    void setCurrentAndTarget(const ChainSettings& settings) noexcept;
+    void setTarget(const ChainSettings& settings) noexcept;
+
+    bool isSmoothing() const noexcept;
+
+    /** Advances all ramps by numSamples and writes the values reached into
+        settings. Only the parameter fields are touched, the version is left
+        for the caller to manage.
+    */
+    void advance(int numSamples, ChainSettings& settings) noexcept;
+
+private:
+    using Linear = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear>;
+    using Multiplicative = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
+
+    // mixes, amounts and depths can sit at 0 so they ramp linearly
+    Linear reverb1Amount, reverb1Mix, reverb1ModDepth;
+    Linear reverb2Amount, reverb2Mix, reverb2ModDepth;
+    Linear dlTime, dlFeedback, dlMix;
+    Linear masterDryWet, parallelRouting;
+
+    // frequencies ramp multiplicatively so a sweep sounds even across octaves
+    Multiplicative reverb1ModRate, reverb2ModRate;
+    Multiplicative masterHighpass, masterLowpass;
+
+    int updateInterval{ 16 };
+
+    JUCE_DECLARE_NON_COPYABLE(ChainSmoother)
+};
@@ -0,0 +1,521 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.cpp
+
+  ==============================================================================
+*/
+
+#include "PartitionedConvolver.h"
+
+namespace
+{
+    using Segment = ImpulseResponseSpectra::Segment;
+
+    // the body ends where the tail starts, three tail blocks in: one block of
+    // overlap-save latency, one block of time for the worker and one block of slack
+    constexpr int tailOffset = 3 * ImpulseResponseSpectra::tailBlockSize;
+
+    int getOrder(int fftSize) noexcept
+    {
+        int order = 0;
+
+        while ((1 << order) < fftSize)
+            ++order;
+
+        return order;
+    }
+
+    int getNumPartitions(int blockSize, int irOffset, int irEnd) noexcept
+    {
+        return juce::jmax(0, (irEnd - irOffset + blockSize - 1) / blockSize);
+    }
+
+    void transformSegment(const Segment& segment, float* destination, const juce::AudioBuffer<float>& ir, int irEnd)
+    {
+        if (segment.numPartitions == 0)
+            return;
+
+        const auto blockSize = segment.blockSize;
+        const auto stride = segment.getPartitionStride();
+
+        juce::dsp::FFT fft(getOrder(2 * blockSize));
+        std::vector<float> scratch((size_t)(4 * blockSize));
+
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        {
+            for (int p = 0; p < segment.numPartitions; ++p)
+            {
+                const auto start = segment.irOffset + p * blockSize;
+                const auto count = juce::jmin(blockSize, irEnd - start);
+
+                std::fill(scratch.begin(), scratch.end(), 0.0f);
+                std::copy(ir.getReadPointer(ch, start), ir.getReadPointer(ch, start) + count, scratch.begin());
+                fft.performRealOnlyForwardTransform(scratch.data(), true);
+
+                std::copy(scratch.begin(), scratch.begin() + (ptrdiff_t)stride,
+                          destination + ((size_t)ch * (size_t)segment.numPartitions + (size_t)p) * stride);
+            }
+        }
+    }
+
+    // acc += a * b over numBins interleaved complex values
+    inline void complexMultiplyAdd(float* acc, const float* a, const float* b, int numBins) noexcept
+    {
+        for (int i = 0; i < 2 * numBins; i += 2)
+        {
+            acc[i]     += a[i] * b[i]     - a[i + 1] * b[i + 1];
+            acc[i + 1] += a[i] * b[i + 1] + a[i + 1] * b[i];
+        }
+    }
+
+    void prepareUniform(const Segment& segment, std::vector<float>& history, std::vector<float>& fdl,
+                        std::vector<float>& output, int& fdlPosition)
+    {
+        history.assign((size_t)(2 * segment.blockSize), 0.0f);
+        fdl.assign((size_t)segment.numPartitions * segment.getPartitionStride(), 0.0f);
+        output.assign((size_t)segment.blockSize, 0.0f);
+        fdlPosition = 0;
+    }
+
+    template <typename State>
+    size_t getStateBytes(const State& state) noexcept
+    {
+        return (state.history.capacity() + state.fdl.capacity() + state.output.capacity()) * sizeof(float);
+    }
+}
+
+//==============================================================================
+ImpulseResponseSpectra::ImpulseResponseSpectra(int numChannelsToUse, int lengthInSamples, double rate)
+    : sampleRate(rate), length(lengthInSamples), numChannels(numChannelsToUse)
+{
+}
+
+size_t ImpulseResponseSpectra::computeLayout(size_t& bodyOffset, size_t& tailOffsetInData)
+{
+    body.blockSize = headSize;
+    body.irOffset = headSize;
+    body.numPartitions = getNumPartitions(headSize, headSize, juce::jmin(length, tailOffset));
+
+    tail.blockSize = tailBlockSize;
+    tail.irOffset = tailOffset;
+    tail.numPartitions = getNumPartitions(tailBlockSize, tailOffset, length);
+
+    bodyOffset = (size_t)numChannels * headSize;
+    tailOffsetInData = bodyOffset + (size_t)numChannels * (size_t)body.numPartitions * body.getPartitionStride();
+
+    return tailOffsetInData + (size_t)numChannels * (size_t)tail.numPartitions * tail.getPartitionStride();
+}
+
+ImpulseResponseSpectra::Ptr ImpulseResponseSpectra::create(const juce::AudioBuffer<float>& impulseResponse, double sampleRate)
+{
+    Ptr spectra = new ImpulseResponseSpectra(impulseResponse.getNumChannels(), impulseResponse.getNumSamples(), sampleRate);
+
+    size_t bodyOffset = 0, tailOffsetInData = 0;
+    spectra->numFloats = spectra->computeLayout(bodyOffset, tailOffsetInData);
+    spectra->storage.calloc(spectra->numFloats);
+
+    auto* destination = spectra->storage.get();
+    const auto length = spectra->length;
+
+    for (int ch = 0; ch < spectra->numChannels; ++ch)
+        std::copy(impulseResponse.getReadPointer(ch), impulseResponse.getReadPointer(ch) + juce::jmin(headSize, length),
+                  destination + (size_t)ch * headSize);
+
+    transformSegment(spectra->body, destination + bodyOffset, impulseResponse, juce::jmin(length, tailOffset));
+    transformSegment(spectra->tail, destination + tailOffsetInData, impulseResponse, length);
+
+    spectra->data = destination;
+    spectra->body.bins = destination + bodyOffset;
+    spectra->tail.bins = destination + tailOffsetInData;
+
+    return spectra;
+}
+
+ImpulseResponseSpectra::Ptr ImpulseResponseSpectra::createFromData(const float* data, size_t numFloats,
+                                                                   int numChannels, int length, double sampleRate)
+{
+    if (numChannels <= 0 || length <= 0)
+        return nullptr;
+
+    Ptr spectra = new ImpulseResponseSpectra(numChannels, length, sampleRate);
+
+    size_t bodyOffset = 0, tailOffsetInData = 0;
+
+    if (spectra->computeLayout(bodyOffset, tailOffsetInData) != numFloats)
+        return nullptr;
+
+    spectra->numFloats = numFloats;
+    spectra->storage.malloc(numFloats);
+    std::copy(data, data + numFloats, spectra->storage.get());
+
+    auto* destination = spectra->storage.get();
+    spectra->data = destination;
+    spectra->body.bins = destination + bodyOffset;
+    spectra->tail.bins = destination + tailOffsetInData;
+
+    return spectra;
+}
+
+//==============================================================================
+PartitionedConvolver::PartitionedConvolver()
+    : juce::Thread("Convolution Tail")
+{
+}
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+    signalThreadShouldExit();
+    tailJobReady.signal();
+    stopThread(2000);
+}
+
+void PartitionedConvolver::prepare(ImpulseResponseSpectra::Ptr newSpectra, int maximumChannels)
+{
+    jassert(newSpectra != nullptr);
+
+    spectra = std::move(newSpectra);
+    numChannels = juce::jmax(1, maximumChannels);
+
+    const auto& body = spectra->body;
+    const auto& tail = spectra->tail;
+
+    channels.resize((size_t)numChannels);
+
+    for (auto& state : channels)
+    {
+        state.headHistory.assign((size_t)(2 * ImpulseResponseSpectra::headSize), 0.0f);
+        prepareUniform(body, state.body.history, state.body.fdl, state.body.output, state.body.fdlPosition);
+        prepareUniform(tail, state.tail.history, state.tail.fdl, state.tail.output, state.tail.fdlPosition);
+        state.tailInput.assign((size_t)tail.blockSize, 0.0f);
+        state.tailOutput.assign((size_t)tail.blockSize, 0.0f);
+    }
+
+    for (auto& job : tailJobs)
+    {
+        job.input.assign((size_t)numChannels * (size_t)tail.blockSize, 0.0f);
+        job.output.assign(job.input.size(), 0.0f);
+        job.blockIndex = noTailBlock;
+    }
+
+    bodyFFT = std::make_unique<juce::dsp::FFT>(getOrder(2 * ImpulseResponseSpectra::headSize));
+    bodyScratch.assign((size_t)(4 * ImpulseResponseSpectra::headSize), 0.0f);
+    bodyAccumulator.assign(bodyScratch.size(), 0.0f);
+
+    if (tail.numPartitions > 0)
+    {
+        tailFFT = std::make_unique<juce::dsp::FFT>(getOrder(2 * tail.blockSize));
+        tailScratch.assign((size_t)(4 * tail.blockSize), 0.0f);
+        tailAccumulator.assign(tailScratch.size(), 0.0f);
+
+        // the audio thread only waits on it briefly, so it mustn't be preempted by ordinary work
+        if (! isThreadRunning() && ! startRealtimeThread(juce::Thread::RealtimeOptions{}) && ! isThreadRunning())
+            startThread(juce::Thread::Priority::highest);
+    }
+
+    bodyPosition = 0;
+    tailPosition = 0;
+}
+
+void PartitionedConvolver::reset() noexcept
+{
+    for (auto& state : channels)
+    {
+        std::fill(state.headHistory.begin(), state.headHistory.end(), 0.0f);
+
+        std::fill(state.body.history.begin(), state.body.history.end(), 0.0f);
+        std::fill(state.body.output.begin(), state.body.output.end(), 0.0f);
+        state.body.numValidPartitions = 0;
+
+        std::fill(state.tailInput.begin(), state.tailInput.end(), 0.0f);
+        std::fill(state.tailOutput.begin(), state.tailOutput.end(), 0.0f);
+    }
+
+    // the tail state may belong to the worker right now, it starts over with the next job
+    // and whatever is still in flight is never played
+    for (auto& job : tailJobs)
+        job.blockIndex = noTailBlock;
+
+    tailResetPending = true;
+    numMissedTailBlocks = 0;
+
+    bodyPosition = 0;
+    tailPosition = 0;
+}
+
+size_t PartitionedConvolver::getMemoryFootprintBytes() const noexcept
+{
+    size_t bytes = (bodyScratch.capacity() + bodyAccumulator.capacity()
+                    + tailScratch.capacity() + tailAccumulator.capacity()) * sizeof(float);
+
+    for (auto& job : tailJobs)
+        bytes += (job.input.capacity() + job.output.capacity()) * sizeof(float);
+
+    for (auto& state : channels)
+        bytes += (state.headHistory.capacity() + state.tailInput.capacity() + state.tailOutput.capacity()) * sizeof(float)
+               + getStateBytes(state.body) + getStateBytes(state.tail);
+
+    return bytes;
+}
+
+//==============================================================================
+void PartitionedConvolver::process(const float* const* input, float* const* output, int numChannelsToProcess, int numSamples) noexcept
+{
+    jassert(spectra != nullptr);
+
+    numChannelsToProcess = juce::jmin(numChannelsToProcess, numChannels);
+
+    const float* inputChunk[2];
+    float* outputChunk[2];
+    jassert(numChannelsToProcess <= 2);
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        // chunks end on head block boundaries, where the body runs
+        const auto chunk = juce::jmin(numSamples - offset, ImpulseResponseSpectra::headSize - bodyPosition);
+
+        for (int ch = 0; ch < numChannelsToProcess; ++ch)
+        {
+            inputChunk[ch] = input[ch] + offset;
+            outputChunk[ch] = output[ch] + offset;
+        }
+
+        processChunk(inputChunk, outputChunk, numChannelsToProcess, chunk);
+        offset += chunk;
+    }
+}
+
+void PartitionedConvolver::processChunk(const float* const* input, float* const* output, int numChannelsToProcess, int numSamples) noexcept
+{
+    constexpr int headSize = ImpulseResponseSpectra::headSize;
+    const auto& body = spectra->body;
+    const auto& tail = spectra->tail;
+    const auto lastIrChannel = spectra->getNumChannels() - 1;
+
+    for (int ch = 0; ch < numChannelsToProcess; ++ch)
+    {
+        auto& state = channels[(size_t)ch];
+        const auto irChannel = juce::jmin(ch, lastIrChannel);
+        auto* out = output[ch];
+
+        // head: direct FIR over the last headSize - 1 inputs followed by this chunk
+        auto* history = state.headHistory.data();
+        juce::FloatVectorOperations::copy(history + headSize - 1, input[ch], numSamples);
+
+        const auto* taps = spectra->getHead(irChannel);
+        juce::FloatVectorOperations::multiply(out, history + headSize - 1, taps[0], numSamples);
+
+        for (int k = 1; k < headSize; ++k)
+            juce::FloatVectorOperations::addWithMultiply(out, history + headSize - 1 - k, taps[k], numSamples);
+
+        std::memmove(history, history + numSamples, (size_t)(headSize - 1) * sizeof(float));
+
+        // body: computed when the previous head block completed
+        if (body.numPartitions > 0)
+        {
+            juce::FloatVectorOperations::add(out, state.body.output.data() + bodyPosition, numSamples);
+            juce::FloatVectorOperations::copy(state.body.history.data() + headSize + bodyPosition, input[ch], numSamples);
+        }
+
+        if (tail.numPartitions > 0)
+        {
+            juce::FloatVectorOperations::add(out, state.tailOutput.data() + tailPosition, numSamples);
+            juce::FloatVectorOperations::copy(state.tailInput.data() + tailPosition, input[ch], numSamples);
+        }
+    }
+
+    bodyPosition += numSamples;
+    tailPosition += numSamples;
+
+    if (bodyPosition == headSize)
+    {
+        bodyPosition = 0;
+
+        if (body.numPartitions > 0)
+        {
+            for (int ch = 0; ch < numChannelsToProcess; ++ch)
+            {
+                auto& state = channels[(size_t)ch];
+                runUniformStep(body, juce::jmin(ch, lastIrChannel), state.body, nullptr,
+                               *bodyFFT, bodyScratch, bodyAccumulator);
+            }
+        }
+    }
+
+    if (tail.numPartitions > 0 && tailPosition == tail.blockSize)
+    {
+        tailPosition = 0;
+        finishTailBlock();
+    }
+}
+
+// newBlock == nullptr means the second half of state.history was already filled in place
+void PartitionedConvolver::runUniformStep(const ImpulseResponseSpectra::Segment& segment, int irChannel, UniformState& state,
+                                          const float* newBlock, juce::dsp::FFT& fft, std::vector<float>& scratch,
+                                          std::vector<float>& accumulator) noexcept
+{
+    const auto blockSize = segment.blockSize;
+    const auto numBins = segment.getNumBins();
+    const auto stride = segment.getPartitionStride();
+    auto* history = state.history.data();
+
+    if (newBlock != nullptr)
+        juce::FloatVectorOperations::copy(history + blockSize, newBlock, blockSize);
+
+    // the newest spectrum goes into the delay line...
+    juce::FloatVectorOperations::copy(scratch.data(), history, 2 * blockSize);
+    juce::FloatVectorOperations::clear(scratch.data() + 2 * blockSize, 2 * blockSize);
+    fft.performRealOnlyForwardTransform(scratch.data(), true);
+
+    auto* fdl = state.fdl.data();
+    juce::FloatVectorOperations::copy(fdl + (size_t)state.fdlPosition * stride, scratch.data(), (int)stride);
+
+    // ...and every partition meets the input spectrum it is delayed by, as far back as the last reset
+    state.numValidPartitions = juce::jmin(state.numValidPartitions + 1, segment.numPartitions);
+    juce::FloatVectorOperations::clear(accumulator.data(), (int)accumulator.size());
+
+    for (int p = 0, slot = state.fdlPosition; p < state.numValidPartitions; ++p)
+    {
+        complexMultiplyAdd(accumulator.data(), fdl + (size_t)slot * stride, segment.getPartition(irChannel, p), numBins);
+
+        if (--slot < 0)
+            slot = segment.numPartitions - 1;
+    }
+
+    fft.performRealOnlyInverseTransform(accumulator.data());
+
+    // overlap-save: only the second half is free of wrap-around
+    juce::FloatVectorOperations::copy(state.output.data(), accumulator.data() + blockSize, blockSize);
+    juce::FloatVectorOperations::copy(history, history + blockSize, blockSize);
+
+    if (++state.fdlPosition == segment.numPartitions)
+        state.fdlPosition = 0;
+}
+
+// Blocks that never reached the worker go into the delay line as silence, so everything
+// older stays on the partition it belongs to. Only the first half of history, the block
+// before them, is read and then cleared.
+void PartitionedConvolver::insertSilentBlocks(const ImpulseResponseSpectra::Segment& segment, UniformState& state, int numBlocks,
+                                              juce::dsp::FFT& fft, std::vector<float>& scratch) noexcept
+{
+    const auto blockSize = segment.blockSize;
+    const auto stride = segment.getPartitionStride();
+    auto* history = state.history.data();
+
+    for (int b = 0; b < juce::jmin(numBlocks, segment.numPartitions); ++b)
+    {
+        // the window is the previous block followed by silence, after the first one it is all silence
+        juce::FloatVectorOperations::copy(scratch.data(), history, blockSize);
+        juce::FloatVectorOperations::clear(scratch.data() + blockSize, 3 * blockSize);
+        fft.performRealOnlyForwardTransform(scratch.data(), true);
+
+        juce::FloatVectorOperations::copy(state.fdl.data() + (size_t)state.fdlPosition * stride, scratch.data(), (int)stride);
+        juce::FloatVectorOperations::clear(history, blockSize);
+
+        state.numValidPartitions = juce::jmin(state.numValidPartitions + 1, segment.numPartitions);
+
+        if (++state.fdlPosition == segment.numPartitions)
+            state.fdlPosition = 0;
+    }
+}
+
+//==============================================================================
+bool PartitionedConvolver::waitForTailJobs(juce::int64 numJobs) noexcept
+{
+    // the worker has had a block more than it needs, if it still isn't done the audio thread doesn't wait it out
+    while (numTailJobsDone.load(std::memory_order_acquire) < numJobs)
+        if (! tailJobDone.wait(waitsForTail ? -1.0 : maximumTailWaitMs))
+            return numTailJobsDone.load(std::memory_order_acquire) >= numJobs;
+
+    return true;
+}
+
+void PartitionedConvolver::finishTailBlock() noexcept
+{
+    const auto blockSize = spectra->tail.blockSize;
+    const auto numPosted = numTailJobsPosted.load(std::memory_order_relaxed);
+
+    // the job posted two blocks ago covers the block starting now...
+    const TailJob* due = nullptr;
+
+    for (auto& job : tailJobs)
+        if (job.blockIndex == tailBlockIndex - 2)
+            due = &job;
+
+    // ...and the older of the two takes the block that just filled up, which is due two blocks from now
+    auto& next = tailJobs[(size_t)(numPosted % 2)];
+
+    if (! waitForTailJobs(juce::jmax(numPosted - 1, due != nullptr ? due->sequence + 1 : 0)))
+    {
+        // the worker is a whole block behind: the tail sits this block out, the block that
+        // just filled up enters it as silence, and the late result is never played
+        for (auto& state : channels)
+            juce::FloatVectorOperations::clear(state.tailOutput.data(), blockSize);
+
+        ++numMissedTailBlocks;
+        ++tailBlockIndex;
+        return;
+    }
+
+    for (size_t ch = 0; ch < channels.size(); ++ch)
+    {
+        auto& state = channels[ch];
+        const auto offset = ch * (size_t)blockSize;
+
+        if (due != nullptr)
+            juce::FloatVectorOperations::copy(state.tailOutput.data(), due->output.data() + offset, blockSize);
+        else
+            juce::FloatVectorOperations::clear(state.tailOutput.data(), blockSize);
+
+        juce::FloatVectorOperations::copy(next.input.data() + offset, state.tailInput.data(), blockSize);
+    }
+
+    next.numMissedBlocks = tailResetPending ? 0 : numMissedTailBlocks;
+    next.reset = tailResetPending;
+    next.sequence = numPosted;
+    next.blockIndex = tailBlockIndex++;
+    numMissedTailBlocks = 0;
+    tailResetPending = false;
+
+    numTailJobsPosted.store(numPosted + 1, std::memory_order_release);
+    tailJobReady.signal();
+}
+
+void PartitionedConvolver::run()
+{
+    while (! threadShouldExit())
+    {
+        tailJobReady.wait(-1);
+
+        const auto& tail = spectra->tail;
+        const auto lastIrChannel = spectra->getNumChannels() - 1;
+
+        // one signal may stand for two jobs, they are taken in the order they were posted
+        for (auto numDone = numTailJobsDone.load(std::memory_order_relaxed);
+             numDone < numTailJobsPosted.load(std::memory_order_acquire) && ! threadShouldExit(); ++numDone)
+        {
+            auto& job = tailJobs[(size_t)(numDone % 2)];
+
+            for (size_t ch = 0; ch < channels.size(); ++ch)
+            {
+                auto& state = channels[ch].tail;
+                const auto offset = ch * (size_t)tail.blockSize;
+
+                if (job.reset)
+                {
+                    std::fill(state.history.begin(), state.history.end(), 0.0f);
+                    std::fill(state.output.begin(), state.output.end(), 0.0f);
+                    state.numValidPartitions = 0;
+                }
+
+                insertSilentBlocks(tail, state, job.numMissedBlocks, *tailFFT, tailScratch);
+                runUniformStep(tail, juce::jmin((int)ch, lastIrChannel), state, job.input.data() + offset,
+                               *tailFFT, tailScratch, tailAccumulator);
+                juce::FloatVectorOperations::copy(job.output.data() + offset, state.output.data(), tail.blockSize);
+            }
+
+            numTailJobsDone.store(numDone + 1, std::memory_order_release);
+            tailJobDone.signal();
+        }
+    }
+}
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.h
+
+    Zero latency convolution for long impulse responses, split in three:
+
+      head  the first headSize taps, a direct FIR
+      body  up to 3 * tailBlockSize, FFT partitions of headSize run on the
+            audio thread
+      tail  the rest, FFT partitions of tailBlockSize run on a background
+            thread. Each step is due two tail blocks after it is posted,
+            one more than the worker needs, so a step that runs late can
+            spill into the next block unheard. Only if the worker falls a
+            whole block behind does the tail drop out until it catches up,
+            rather than the audio thread waiting on it, except in offline
+            renders
+
+    ImpulseResponseSpectra holds the precomputed partitions and never
+    changes once built, so it can be shared. PartitionedConvolver is the
+    running state of one instance.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <limits>
+#include <vector>
+
+struct ImpulseResponseSpectra  : public juce::ReferenceCountedObject
+{
+    using Ptr = juce::ReferenceCountedObjectPtr<ImpulseResponseSpectra>;
+
+    static constexpr int headSize = 128;
+    static constexpr int tailBlockSize = 2048;
+
+    struct Segment
+    {
+        int blockSize = 0;        // partition length, the FFT is twice as long
+        int numPartitions = 0;
+        int irOffset = 0;         // first tap this segment covers
+
+        // per channel and partition, blockSize + 1 complex bins as interleaved re/im
+        const float* bins = nullptr;
+
+        int getNumBins() const noexcept { return blockSize + 1; }
+        size_t getPartitionStride() const noexcept { return (size_t)getNumBins() * 2; }
+
+        const float* getPartition(int channel, int partition) const noexcept
+        {
+            return bins + ((size_t)channel * (size_t)numPartitions + (size_t)partition) * getPartitionStride();
+        }
+    };
+
+    // partitions and transforms an impulse response that is already at sampleRate
+    static Ptr create(const juce::AudioBuffer<float>& impulseResponse, double sampleRate);
+
+    /** Copies data laid out like getData() (see ImpulseResponseCache) into its
+        own memory, so the audio thread never touches the file it came from.
+        Returns nullptr if numFloats doesn't fit the layout for that channel
+        count and length.
+    */
+    static Ptr createFromData(const float* data, size_t numFloats, int numChannels, int length, double sampleRate);
+
+    int getNumChannels() const noexcept { return numChannels; }
+    const float* getHead(int channel) const noexcept { return data + (size_t)channel * headSize; }
+
+    // everything in one block: the head taps per channel, then the body and tail bins
+    const float* getData() const noexcept { return data; }
+    size_t getNumFloats() const noexcept { return numFloats; }
+
+    size_t getMemoryFootprintBytes() const noexcept { return numFloats * sizeof(float); }
+
+    double sampleRate = 0.0;
+    int length = 0;
+
+    Segment body, tail;
+
+private:
+    ImpulseResponseSpectra(int numChannels, int length, double sampleRate);
+
+    // floats the whole layout takes, with the segments' offsets filled in
+    size_t computeLayout(size_t& bodyOffset, size_t& tailOffset);
+
+    int numChannels = 0;
+    const float* data = nullptr;
+    size_t numFloats = 0;
+
+    juce::HeapBlock<float> storage;
+};
+
+//==============================================================================
+class PartitionedConvolver  : private juce::Thread
+{
+public:
+    PartitionedConvolver();
+    ~PartitionedConvolver() override;
+
+    /** Message or loader thread. Sizes all running state for these spectra and
+        starts the tail worker if the impulse response has a tail.
+    */
+    void prepare(ImpulseResponseSpectra::Ptr newSpectra, int maximumChannels);
+
+    /** Audio thread safe: never waits for the tail worker and never clears the
+        delay lines, which only count as filled again once new input reaches them.
+    */
+    void reset() noexcept;
+
+    // audio thread: offline renders wait for the tail however long it takes, so they never depend on timing
+    void setNonRealtime(bool isNonRealtime) noexcept { waitsForTail = isNonRealtime; }
+
+    const ImpulseResponseSpectra* getSpectra() const noexcept { return spectra.get(); }
+    size_t getMemoryFootprintBytes() const noexcept;
+
+    /** Audio thread. Writes the convolution of input into output, which must
+        not alias. Input channels past the impulse response's last channel
+        use its last channel.
+    */
+    void process(const float* const* input, float* const* output, int numChannels, int numSamples) noexcept;
+
+private:
+    struct UniformState
+    {
+        std::vector<float> history;   // overlap-save window, previous block then current
+        std::vector<float> fdl;       // frequency domain delay line, one spectrum per partition
+        std::vector<float> output;    // what this segment adds over the current block
+        int fdlPosition = 0;
+
+        // the spectra written since the last reset, older slots are left stale instead of cleared
+        int numValidPartitions = 0;
+    };
+
+    struct ChannelState
+    {
+        std::vector<float> headHistory;
+        UniformState body, tail;
+        std::vector<float> tailInput, tailOutput;   // the audio thread's side of the tail
+    };
+
+    void processChunk(const float* const* input, float* const* output, int numChannels, int numSamples) noexcept;
+    void runUniformStep(const ImpulseResponseSpectra::Segment& segment, int irChannel, UniformState& state,
+                        const float* newBlock, juce::dsp::FFT& fft, std::vector<float>& scratch,
+                        std::vector<float>& accumulator) noexcept;
+    void insertSilentBlocks(const ImpulseResponseSpectra::Segment& segment, UniformState& state, int numBlocks,
+                            juce::dsp::FFT& fft, std::vector<float>& scratch) noexcept;
+    void finishTailBlock() noexcept;
+    bool waitForTailJobs(juce::int64 numJobs) noexcept;
+    void run() override;
+
+    ImpulseResponseSpectra::Ptr spectra;
+    int numChannels = 0;
+
+    std::vector<ChannelState> channels;
+    int bodyPosition = 0, tailPosition = 0;
+
+    std::unique_ptr<juce::dsp::FFT> bodyFFT, tailFFT;
+    std::vector<float> bodyScratch, bodyAccumulator, tailScratch, tailAccumulator;
+
+    // how long the audio thread waits for a late tail block before it gives up on it
+    static constexpr double maximumTailWaitMs = 1.0;
+
+    static constexpr juce::int64 noTailBlock = std::numeric_limits<juce::int64>::min();
+
+    // One tail step for every channel. The audio thread fills one in before it posts it and
+    // only touches it again once the worker has counted it done; the worker runs them in
+    // the order they were posted, so there are at most two in flight.
+    struct TailJob
+    {
+        std::vector<float> input, output;   // a tail block per channel, one channel after the other
+        int numMissedBlocks = 0;            // blocks dropped while the worker was late, they enter the tail as silence
+        bool reset = false;                 // start the tail over before running this block
+
+        // audio thread only
+        juce::int64 sequence = 0;           // how many jobs were posted before this one
+        juce::int64 blockIndex = noTailBlock;   // the tail block its input came from, noTailBlock once it will never be played
+    };
+
+    std::array<TailJob, 2> tailJobs;
+    juce::WaitableEvent tailJobReady, tailJobDone;
+    std::atomic<juce::int64> numTailJobsPosted{ 0 }, numTailJobsDone{ 0 };
+
+    // audio thread only: what goes into the next job, and which tail block just filled up
+    juce::int64 tailBlockIndex = 0;
+    int numMissedTailBlocks = 0;
+    bool tailResetPending = false, waitsForTail = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedConvolver)
+};
@@ -8,16 +8,62 @@
 
 #include "PluginProcessor.h"
 
+namespace
+{
+    // readouts for labels in the magic GUI. The labels bind to them through magicState's
+    // properties, but they are measurements rather than settings, so they are never saved
+    const juce::Identifier dspLoadP50Property{ "dspLoadP50" };
+    const juce::Identifier dspLoadP99Property{ "dspLoadP99" };
+    const juce::Identifier dspLoadMaxProperty{ "dspLoadMax" };
+    const juce::Identifier dspXrunRisksProperty{ "dspXrunRisks" };
+    const juce::Identifier dspHealthTripsProperty{ "dspHealthTrips" };
+
+    const juce::Identifier analysisRmsDbProperty{ "analysisRmsDb" };
+    const juce::Identifier analysisPeakDbProperty{ "analysisPeakDb" };
+    const juce::Identifier analysisRt60Property{ "analysisRt60" };
+
+    const juce::Identifier readoutProperties[] = { dspLoadP50Property, dspLoadP99Property, dspLoadMaxProperty,
+                                                   dspXrunRisksProperty, dspHealthTripsProperty,
+                                                   analysisRmsDbProperty, analysisPeakDbProperty, analysisRt60Property };
+
+    // wherever magicState keeps its properties in the saved tree
+    void removeReadouts(juce::ValueTree tree)
+    {
+        for (const auto& property : readoutProperties)
+            tree.removeProperty(property, nullptr);
+
+        for (auto child : tree)
+            removeReadouts(child);
+    }
+
+    //==============================================================================
+    // the band a master filter has to leave alone before it may be taken out of the chain
+    constexpr double audibleLowest = 20.0, audibleHighest = 20000.0;
+
+    // 0.1 dB, as the (f / fc)^2n term of the Butterworth magnitude 1 / (1 + (f / fc)^2n)
+    const double inaudibleDeviation = std::pow(10.0, 0.1 / 10.0) - 1.0;
+
+    /** Whether a bilinear Butterworth of this order stays within 0.1 dB of unity across the
+        audible band. Its response at f goes with tan(pi f / fs) / tan(pi fc / fs), so a low
+        pass needs its cutoff well above 20 kHz, or at Nyquist when that is lower, and a high
+        pass well below 20 Hz.
+    */
+    bool isFilterInaudible(bool isLowPass, double cutoff, int order, double sampleRate)
+    {
+        const auto nyquist = 0.5 * sampleRate;
+
+        if (isLowPass && cutoff >= nyquist)
+            return true;
+
+        if (isLowPass && audibleHighest >= nyquist)
+            return false;
 
-struct ChainSettings {
-    //float dlFeedback{ 0 }, dlTime{ 0 };
-    float reverb1Amount{ 0 }, reverb1Mix{ 0 }, reverb1ModRate{ 0 }, reverb1ModDepth{ 0 };
-    float reverb2Amount{ 0 }, reverb2Mix{ 0 }, reverb2ModRate{ 0 }, reverb2ModDepth{ 0 };
-    float masterHighpass{ 0 }, masterLowpass{ 0 }, masterDryWet{ 0 };
-};
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState&);
-void linkChainSettings(ChainSettings);
+        const auto warp = [sampleRate](double f) { return std::tan(juce::MathConstants<double>::pi * f / sampleRate); };
+        const auto ratio = isLowPass ? warp(audibleHighest) / warp(cutoff) : warp(cutoff) / warp(audibleLowest);
 
+        return std::pow(ratio, 2.0 * order) <= inaudibleDeviation;
+    }
+}
 
 //==============================================================================
 MarsAudioProcessor::MarsAudioProcessor()
@@ -33,10 +79,170 @@ MarsAudioProcessor::MarsAudioProcessor()
 #endif
 {
     FOLEYS_SET_SOURCE_PATH(__FILE__);
+
+    dspLoadPlot = magicState.createAndAddObject<DspLoadPlot>("dspLoad", dspLoadMeter);
+    spectrumPlot = magicState.createAndAddObject<SpectrumPlot>("spectrum", signalAnalyser);
+    levelPlot = magicState.createAndAddObject<LevelPlot>("levels", signalAnalyser);
+    decayPlot = magicState.createAndAddObject<DecayPlot>("decay", signalAnalyser);
+
+    presetBank.loadUserPresets();
+
+    // fast enough to pick up every frame of the analyser
+    startTimerHz(SignalAnalyser::frameRateHz);
 }
 
 MarsAudioProcessor::~MarsAudioProcessor()
 {
+    stopTimer();
+    signalAnalyser.stop();
+    bounceEngine.stop();
+    chainBuilder.removeAllJobs(true, 4000);
+
+    delete pendingPreset.exchange(nullptr);
+    delete retiredPreset.exchange(nullptr);
+
+    delete pendingChain.exchange(nullptr);
+    delete retiredChain.exchange(nullptr);
+    delete activeChain.exchange(nullptr);
+    delete fadingChain;
+}
+
+void MarsAudioProcessor::timerCallback()
+{
+    // the snapshot the audio thread was done with
+    delete retiredPreset.exchange(nullptr);
+
+    // the chain a rebuilt one replaced. An impulse response picked while the new one was
+    // being built only went to the old chain, so it is loaded again here
+    if (auto* retired = retiredChain.exchange(nullptr))
+    {
+        delete retired;
+
+        for (int slot = 0; slot < 2; ++slot)
+            if (impulseResponseFiles[slot] != juce::File() && getImpulseResponseFile(slot) != impulseResponseFiles[slot])
+                loadImpulseResponse(slot, impulseResponseFiles[slot]);
+    }
+
+    auto& chain = getChain();
+    chain.feedbackDelay.allocateIfRequested();
+
+    const auto& reverb1 = chain.stereoChain.get<ChainPositions::Reverb1>().convolution;
+    const auto& reverb2 = chain.stereoChain.get<ChainPositions::Reverb2>().convolution;
+
+    const double convolutionTails[] = { reverb1.getTailSeconds(), reverb2.getTailSeconds() };
+
+    if (convolutionTails[0] != convolutionTailSeconds[0] || convolutionTails[1] != convolutionTailSeconds[1])
+    {
+        convolutionTailSeconds[0] = convolutionTails[0];
+        convolutionTailSeconds[1] = convolutionTails[1];
+        impulseResponsesChanged = true;
+    }
+
+    const auto latency = oversamplingLatency.load();
+
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+
+    publishDspLoad();
+    publishAnalysis();
+}
+
+void MarsAudioProcessor::publishDspLoad()
+{
+    const auto load = dspLoadMeter.getSnapshot();
+
+    // percent of the deadline, for labels in the magic GUI
+    magicState.getPropertyAsValue(dspLoadP50Property.toString()).setValue(juce::roundToInt(load.p50 * 100.0f));
+    magicState.getPropertyAsValue(dspLoadP99Property.toString()).setValue(juce::roundToInt(load.p99 * 100.0f));
+    magicState.getPropertyAsValue(dspLoadMaxProperty.toString()).setValue(juce::roundToInt(load.max * 100.0f));
+    magicState.getPropertyAsValue(dspXrunRisksProperty.toString()).setValue((juce::int64)load.numXrunRisks);
+    magicState.getPropertyAsValue(dspHealthTripsProperty.toString()).setValue((juce::int64)healthMonitor.getTotalTrips());
+
+    if (dspLoadPlot != nullptr)
+        dspLoadPlot->update();
+}
+
+void MarsAudioProcessor::publishAnalysis()
+{
+    // nobody looks at the plots without an editor, so the analysis thread goes away with it
+    if (getActiveEditor() == nullptr)
+    {
+        if (signalAnalyser.isActive())
+            signalAnalyser.stop();
+
+        return;
+    }
+
+    if (! signalAnalyser.isActive())
+        signalAnalyser.start();
+
+    // tenths of a dB and milliseconds, for labels in the magic GUI
+    magicState.getPropertyAsValue(analysisRmsDbProperty.toString()).setValue(juce::roundToInt(signalAnalyser.getRmsDb() * 10.0f) / 10.0);
+    magicState.getPropertyAsValue(analysisPeakDbProperty.toString()).setValue(juce::roundToInt(signalAnalyser.getPeakDb() * 10.0f) / 10.0);
+    magicState.getPropertyAsValue(analysisRt60Property.toString()).setValue(juce::roundToInt(signalAnalyser.getRt60Seconds() * 1000.0f));
+
+    if (spectrumPlot != nullptr)
+        spectrumPlot->update();
+
+    if (levelPlot != nullptr)
+        levelPlot->update();
+
+    if (decayPlot != nullptr)
+        decayPlot->update();
+}
+
+bool MarsAudioProcessor::exportDspLoad(const juce::File& file) const
+{
+    return dspLoadMeter.exportToFile(file, { "Delay", "Reverb1", "Reverb2", "Chorus", "Filters" });
+}
+
+bool MarsAudioProcessor::loadImpulseResponse(int reverbSlot, const juce::File& file)
+{
+    jassert(reverbSlot == 0 || reverbSlot == 1);
+
+    auto& chain = getChain();
+    auto& slot = reverbSlot == 0 ? chain.stereoChain.get<ChainPositions::Reverb1>()
+                                 : chain.stereoChain.get<ChainPositions::Reverb2>();
+
+    if (! slot.convolution.loadImpulseResponse(file))
+        return false;
+
+    impulseResponseFiles[reverbSlot] = file;
+    return true;
+}
+
+juce::File MarsAudioProcessor::getImpulseResponseFile(int reverbSlot) const
+{
+    jassert(reverbSlot == 0 || reverbSlot == 1);
+
+    const auto& chain = getChain();
+    const auto& slot = reverbSlot == 0 ? chain.stereoChain.get<ChainPositions::Reverb1>()
+                                       : chain.stereoChain.get<ChainPositions::Reverb2>();
+
+    return slot.convolution.getImpulseResponseFile();
+}
+
+bool MarsAudioProcessor::waitForImpulseResponses(int timeoutMs) const
+{
+    const auto& chain = getChain();
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)juce::jmax(0, timeoutMs);
+
+    for (const auto* convolution : { &chain.stereoChain.get<ChainPositions::Reverb1>().convolution,
+                                     &chain.stereoChain.get<ChainPositions::Reverb2>().convolution })
+        if (! convolution->waitForLoader(juce::jmax(0, (int)(deadline - juce::Time::getMillisecondCounter()))))
+            return false;
+
+    return true;
+}
+
+size_t MarsAudioProcessor::getMemoryFootprintBytes() const noexcept
+{
+    const auto& chain = getChain();
+
+    return chain.stereoChain.get<ChainPositions::Reverb1>().getMemoryFootprintBytes()
+         + chain.stereoChain.get<ChainPositions::Reverb2>().getMemoryFootprintBytes()
+         + chain.feedbackDelay.getMemoryFootprintBytes()
+         + (size_t)chain.bypassScratch.getNumChannels() * (size_t)chain.bypassScratch.getNumSamples() * sizeof(float);
 }
 
 //==============================================================================
@@ -74,43 +280,107 @@ bool MarsAudioProcessor::isMidiEffect() const
 
 double MarsAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load();
 }
 
 int MarsAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return presetBank.getNumPresets();  // never 0, the factory presets are always there
 }
 
 int MarsAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void MarsAudioProcessor::setCurrentProgram (int index)
 {
+    if (juce::isPositiveAndBelow(index, presetBank.getNumPresets()))
+        applyPreset(index);
 }
 
 const juce::String MarsAudioProcessor::getProgramName (int index)
 {
-    return {};
+    if (! juce::isPositiveAndBelow(index, presetBank.getNumPresets()))
+        return {};
+
+    return presetBank.getPreset(index).name;
 }
 
 void MarsAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    presetBank.renamePreset(index, newName);
+}
+
+bool MarsAudioProcessor::saveUserPreset(const juce::String& name)
+{
+    auto preset = Preset::withDefaults(name);
+
+    for (const auto& spec : parameterSpecs)
+        preset.set(spec.parameter, parameterHandles.get(spec.parameter));
+
+    const auto index = presetBank.saveUserPreset(preset);
+
+    if (index < 0)
+        return false;
+
+    currentProgram = index;
+    updateHostDisplay(ChangeDetails().withProgramChanged(true));
+    return true;
+}
+
+void MarsAudioProcessor::applyPreset(int index)
+{
+    const auto& preset = presetBank.getPreset(index);
+
+    // the whole scene goes over in one piece, before the first parameter changes
+    auto snapshot = std::make_unique<PresetSnapshot>();
+    snapshot->settings = getChainSettings(preset);
+    snapshot->remainingSamples = juce::roundToInt(presetHoldSeconds * UniversalSampleRate);
+    delete pendingPreset.exchange(snapshot.release());
+
+    for (const auto& spec : parameterSpecs)
+    {
+        if (auto* parameter = apvts.getParameter(spec.id))
+        {
+            const auto value = parameter->convertTo0to1(preset.get(spec.parameter));
+
+            if (! juce::approximatelyEqual(parameter->getValue(), value))
+                parameter->setValueNotifyingHost(value);
+        }
+    }
+
+    currentProgram = index;
+}
+
+void MarsAudioProcessor::takePresetSnapshot(ChainSettings& chainSettings, int numSamples) noexcept
+{
+    // the previous snapshot has to be collected by the timer before the next one can be retired
+    if (pendingPreset.load(std::memory_order_acquire) != nullptr && retiredPreset.load() == nullptr)
+    {
+        retiredPreset = activePreset.release();
+        activePreset.reset(pendingPreset.exchange(nullptr));
+    }
+
+    if (activePreset == nullptr)
+        return;
+
+    if (activePreset->remainingSamples <= 0 || chainSettings.hasSameValuesAs(activePreset->settings))
+    {
+        // the parameters have caught up, or never will
+        if (retiredPreset.load() == nullptr)
+            retiredPreset = activePreset.release();
+
+        return;
+    }
+
+    chainSettings = activePreset->settings;
+    activePreset->remainingSamples -= numSamples;
 }
 
 //==============================================================================
 void MarsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    //setting the size of our buffer
-    auto dlBufferSize = 2.0 * (sampleRate * samplesPerBlock);
-    samplesPerSecond = sampleRate * samplesPerBlock;
-    dlAudioBuffer.setSize(getTotalNumOutputChannels(), (int)dlBufferSize);
-    dryBuffer.setSize(getTotalNumOutputChannels(), (int)dlBufferSize);
-    dlAudioBuffer.clear();
-
     UniversalSampleRate = (float)sampleRate;
 
     //setting up the spec for dsp
@@ -118,32 +388,193 @@ void MarsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     spec.maximumBlockSize = samplesPerBlock;
     spec.numChannels = getTotalNumOutputChannels();
 
-    leftChain.reset();
-    rightChain.reset();
+    const auto layout = getChannelLayoutOfBus(false, 0);
+
+    auto chainSettings = getChainSettings(parameterHandles);
+    chainSettings.renderOffline = isNonRealtime();
 
-    leftChain.get<ChainPositions::Reverb1>().prepare(spec);
-    rightChain.get<ChainPositions::Reverb1>().prepare(spec);
-    leftChain.get<ChainPositions::Reverb2>().prepare(spec);
-    rightChain.get<ChainPositions::Reverb2>().prepare(spec);
-    leftChain.get<ChainPositions::Chorus1>().prepare(spec);
-    rightChain.get<ChainPositions::Chorus1>().prepare(spec);
-    leftChain.get<ChainPositions::Chorus2>().prepare(spec);
-    rightChain.get<ChainPositions::Chorus2>().prepare(spec);
-    leftChain.get<ChainPositions::LowPass>().prepare(spec);
-    rightChain.get<ChainPositions::LowPass>().prepare(spec);
-    leftChain.get<ChainPositions::HighPass>().prepare(spec);
-    rightChain.get<ChainPositions::HighPass>().prepare(spec);
+    // The same spec again only clears the chain. A new rate or block size is built in the
+    // background while the current chain keeps playing. The first call, a new channel layout
+    // (which the current chain can't process) and offline renders, which shouldn't depend
+    // on timing, prepare it right here.
+    auto& chain = getChain();
 
-    auto chainSettings = getChainSettings(apvts);
+    // a chain still fading out goes now, the timer frees it unless it is busy with an older one
+    if (fadingChain != nullptr)
+    {
+        if (retiredChain.load() == nullptr)
+            retiredChain = fadingChain;
+        else
+            delete fadingChain;
+
+        fadingChain = nullptr;
+    }
+
+    if (chain.isPreparedFor(spec, layout))
+    {
+        cancelChainBuild();
+        chain.reset();
+    }
+    else if (! (juce::approximatelyEqual(requestedSpec.sampleRate, spec.sampleRate)
+                && requestedSpec.maximumBlockSize == spec.maximumBlockSize
+                && requestedSpec.numChannels == spec.numChannels && requestedLayout == layout))
+    {
+        cancelChainBuild();
 
-    auto lowpassCoefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(UniversalSampleRate, chainSettings.masterLowpass);
-    auto highpassCoefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(UniversalSampleRate, chainSettings.masterHighpass);
+        if (chain.spec.sampleRate > 0.0 && chain.spec.numChannels == spec.numChannels
+            && chain.layout == layout && ! isNonRealtime())
+            startChainBuild(layout, chainSettings);
+        else
+            prepareChain(chain, spec, layout, chainSettings);
+    }
 
-    *leftChain.get<ChainPositions::LowPass>().coefficients = *lowpassCoefficients;
-    *rightChain.get<ChainPositions::LowPass>().coefficients = *lowpassCoefficients;
+    requestedSpec = spec;
+    requestedLayout = layout;
 
-    *leftChain.get<ChainPositions::HighPass>().coefficients = *highpassCoefficients;
-    *rightChain.get<ChainPositions::HighPass>().coefficients = *highpassCoefficients;
+    dspLoadMeter.prepare(sampleRate);
+    silenceGate.prepare(sampleRate);
+    signalAnalyser.setSampleRate(sampleRate);
+
+    chainSmoother.prepare(sampleRate);
+    chainSmoother.setCurrentAndTarget(chainSettings);
+
+    //push everything once, from here on processBlock only reacts to changes
+    chainSettings.version = ++chainSettingsVersion;
+    applyChainSettings(chainSettings);
+    lastChainSettings = chainSettings;
+
+    setLatencySamples(oversamplingLatency.load());
+
+    // a delay that's already turned up shouldn't wait for the timer
+    chain.feedbackDelay.allocateIfRequested();
+}
+
+void MarsAudioProcessor::prepareChain(PreparedChain& chain, const juce::dsp::ProcessSpec& newSpec,
+                                      const juce::AudioChannelSet& newLayout, const ChainSettings& chainSettings)
+{
+    chain.spec = newSpec;
+    chain.layout = newLayout;
+
+    // wider buses fold into the reverbs' stereo engines by channel position
+    chain.stereoChain.get<ChainPositions::Reverb1>().setChannelLayout(newLayout);
+    chain.stereoChain.get<ChainPositions::Reverb2>().setChannelLayout(newLayout);
+
+    chain.stereoChain.get<ChainPositions::LowPass>().setType(CascadedFilter::Type::lowPass);
+    chain.stereoChain.get<ChainPositions::HighPass>().setType(CascadedFilter::Type::highPass);
+
+    chain.stereoChain.reset();
+    chain.stereoChain.prepare(newSpec);
+    updateFilterCoefficients(chain, chainSettings);
+
+    // only allocates if the delay is already in use, otherwise timerCallback does it once it's enabled
+    chain.feedbackDelay.setMaximumDelaySeconds(getParameterSpec(ParameterId::dlTime).maxValue);
+    chain.feedbackDelay.prepare(newSpec);
+
+    chain.modulationOversampler.prepare(newSpec);
+    chain.lfoBank.prepare((int)newSpec.maximumBlockSize << 2);
+
+    for (auto& bypass : chain.bypasses)
+        bypass.prepare(newSpec.sampleRate);
+
+    chain.bypassScratch.setSize((int)newSpec.numChannels, (int)newSpec.maximumBlockSize << 2);
+    chain.branchBuffer.setSize((int)newSpec.numChannels, (int)newSpec.maximumBlockSize);
+    chain.crossfadeBuffer.setSize((int)newSpec.numChannels, (int)newSpec.maximumBlockSize);
+
+    chain.dryWetMixer.prepare(newSpec);
+    chain.dryWetMixer.setMixingRule(juce::dsp::DryWetMixingRule::balanced);
+    chain.dryWetRamp.reset(newSpec.sampleRate, dryWetRampSeconds);
+    chain.dryWetRamp.setCurrentAndTargetValue(chainSettings.masterDryWet);
+
+    // the stages start fully in or out, there is nothing to fade from yet
+    applyStageSettings(chain, chainSettings);
+
+    for (auto& bypass : chain.bypasses)
+        bypass.reset();
+}
+
+void MarsAudioProcessor::startChainBuild(const juce::AudioChannelSet& newLayout, const ChainSettings& chainSettings)
+{
+    std::array<juce::File, 2> files{ impulseResponseFiles[0], impulseResponseFiles[1] };
+
+    chainBuilder.addJob([this, generation = chainBuildGeneration.load(), newSpec = spec, newLayout, chainSettings, files]
+    {
+        buildChain(generation, newSpec, newLayout, chainSettings, files);
+    });
+}
+
+void MarsAudioProcessor::cancelChainBuild()
+{
+    // prepareToPlay never overlaps processBlock, so a chain still waiting can simply go
+    const juce::ScopedLock sl(chainBuildLock);
+    ++chainBuildGeneration;
+    delete pendingChain.exchange(nullptr);
+}
+
+void MarsAudioProcessor::buildChain(int generation, juce::dsp::ProcessSpec newSpec, juce::AudioChannelSet newLayout,
+                                    ChainSettings chainSettings, std::array<juce::File, 2> files)
+{
+    auto isCurrent = [this, generation] { return generation == chainBuildGeneration.load(); };
+
+    auto chain = std::make_unique<PreparedChain>();
+    prepareChain(*chain, newSpec, newLayout, chainSettings);
+    chain->feedbackDelay.allocateIfRequested();
+
+    // the convolution slots start out empty, with the cache this is usually just a lookup
+    ConvolutionReverb* convolutions[] = { &chain->stereoChain.get<ChainPositions::Reverb1>().convolution,
+                                          &chain->stereoChain.get<ChainPositions::Reverb2>().convolution };
+
+    for (int slot = 0; slot < 2; ++slot)
+        if (files[(size_t)slot] != juce::File())
+            convolutions[slot]->loadImpulseResponse(files[(size_t)slot]);
+
+    // both loaders share one deadline, a file that fails to load leaves its slot empty
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)impulseResponseWaitMs;
+
+    for (auto* convolution : convolutions)
+        if (isCurrent())
+            convolution->waitForLoader(juce::jmax(0, (int)(deadline - juce::Time::getMillisecondCounter())));
+
+    const juce::ScopedLock sl(chainBuildLock);
+
+    if (isCurrent())
+        delete pendingChain.exchange(chain.release());
+}
+
+void MarsAudioProcessor::swapInPreparedChain() noexcept
+{
+    // the last chain has to finish fading out and the timer has to collect it before the next one can come in
+    if (pendingChain.load(std::memory_order_acquire) == nullptr || retiredChain.load() != nullptr || fadingChain != nullptr)
+        return;
+
+    // the old chain keeps its tail going while the new one, starting out empty, fades in
+    fadingChain = activeChain.exchange(pendingChain.exchange(nullptr));
+    chainFadeLength = juce::jmax(1, juce::roundToInt(chainCrossfadeSeconds * getChain().spec.sampleRate));
+    chainFadeRemaining = chainFadeLength;
+
+    // the new chain was built from the parameters as they were back then
+    updateFilterCoefficients(getChain(), lastChainSettings);
+    applyChainSettings(lastChainSettings);
+}
+
+bool MarsAudioProcessor::PreparedChain::isPreparedFor(const juce::dsp::ProcessSpec& newSpec,
+                                                      const juce::AudioChannelSet& newLayout) const noexcept
+{
+    return juce::approximatelyEqual(spec.sampleRate, newSpec.sampleRate)
+        && spec.maximumBlockSize == newSpec.maximumBlockSize
+        && spec.numChannels == newSpec.numChannels
+        && layout == newLayout;
+}
+
+void MarsAudioProcessor::PreparedChain::reset() noexcept
+{
+    stereoChain.reset();
+    feedbackDelay.reset();
+    modulationOversampler.reset();
+    dryWetMixer.reset();
+    lfoBank.reset();
+
+    for (auto& bypass : bypasses)
+        bypass.reset();
 }
 
 
@@ -151,6 +582,17 @@ void MarsAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    getChain().feedbackDelay.releaseMemory();
+}
+
+void MarsAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    foleys::MagicProcessor::setNonRealtime(isNonRealtime);
+
+    if (isNonRealtime)
+        bounceEngine.start();
+    else
+        bounceEngine.stop();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -160,12 +602,11 @@ bool MarsAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // mono, stereo, surround up to 7.1.4 and ambisonics up to third order; anything
+    // wider than stereo runs through the reverbs' SurroundFold
+    const auto& output = layouts.getMainOutputChannelSet();
+
+    if (output.isDisabled() || output.size() > SurroundFold::maximumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -183,322 +624,697 @@ bool MarsAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
 void MarsAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    ScopedAllocationCheck noAllocations;
+    const auto loadStart = dspLoadMeter.beginBlock();
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
         
-    auto chainSettings = getChainSettings(apvts);
-
-    //leftChain.get<ChainPositions::DryMix>().setMixingRule(juce::dsp::DryWetMixingRule::balanced);
-    //rightChain.get<ChainPositions::DryMix>().setMixingRule(juce::dsp::DryWetMixingRule::balanced);
-    //leftChain.get<ChainPositions::DryMix>().setWetMixProportion(chainSettings.masterDryWet);
-    //rightChain.get<ChainPositions::DryMix>().setWetMixProportion(chainSettings.masterDryWet);
+    auto chainSettings = getChainSettings(parameterHandles);
+    takePresetSnapshot(chainSettings, buffer.getNumSamples());
+    chainSettings.renderOffline = isNonRealtime();
 
     /*for (int channel = 0; channel < totalNumInputChannels; ++channel)
     {
         auto* channelData = buffer.getWritePointer (channel);
     }*/
 
+    chainSmoother.setTarget(chainSettings);
+
+    //linkChainSettings(chainSettings);
+    
+    swapInPreparedChain();
+    syncModulation();
+
+    juce::dsp::AudioBlock<float> block(buffer);
+    const auto numSamples = (int)block.getNumSamples();
+
+    // the host's block size, unless a chain built for a smaller one is still playing or fading out
+    auto maximumSubBlockSize = (int)getChain().spec.maximumBlockSize;
+
+    if (fadingChain != nullptr)
+        maximumSubBlockSize = juce::jmin(maximumSubBlockSize, (int)fadingChain->spec.maximumBlockSize);
+
+    if (impulseResponsesChanged.exchange(false))
+        updateTailLength(lastChainSettings);
+
+    // nothing coming in and nothing left ringing: keep the parameters current but skip the DSP
+    if (silenceGate.shouldSkip(buffer))
+    {
+        chainSmoother.advance(numSamples, chainSettings);
+        updateChain(chainSettings);
+        signalAnalyser.pushSamples(buffer);
+        dspLoadMeter.endBlock(loadStart, numSamples);
+        return;
+    }
+
+    // while anything is still ramping the chain is re-applied every updateInterval
+    // samples, once everything has settled the rest of the block goes in one piece
+    for (int start = 0; start < numSamples;)
+    {
+        auto subBlockSize = chainSmoother.isSmoothing() ? juce::jmin(chainSmoother.getUpdateInterval(), numSamples - start)
+                                                        : numSamples - start;
+        subBlockSize = juce::jmin(subBlockSize, maximumSubBlockSize);
+
+        chainSmoother.advance(subBlockSize, chainSettings);
+        updateChain(chainSettings);
+
+        auto subBlock = block.getSubBlock((size_t)start, (size_t)subBlockSize);
+
+        if (fadingChain != nullptr)
+            processChainCrossfade(subBlock);
+        else
+            processChain(getChain(), subBlock);
+
+        start += subBlockSize;
+    }
+
+    silenceGate.blockProcessed(buffer);
+    signalAnalyser.pushSamples(buffer);
+    dspLoadMeter.endBlock(loadStart, numSamples);
+}
+
+template <typename Function>
+void MarsAudioProcessor::runMeteredStage(PreparedChain& chain, MeteredStage stage, juce::dsp::AudioBlock<float>& block, Function&& function)
+{
+    dspLoadMeter.measureStage(stage, function);
+
+    if (! healthMonitor.check(stage, block))
+        resetMeteredStage(chain, stage);
+}
+
+template <typename Function>
+void MarsAudioProcessor::runElidableStage(PreparedChain& chain, ChainPositions position, juce::dsp::AudioBlock<float>& block,
+                                          float bypassGain, Function&& function)
+{
+    chain.bypasses[(size_t)position].process(block, chain.bypassScratch, bypassGain, function);
+}
+
+void MarsAudioProcessor::resetMeteredStage(PreparedChain& chain, MeteredStage stage)
+{
+    switch (stage)
+    {
+        case DelayStage:   chain.feedbackDelay.reset(); break;
+        case Reverb1Stage: chain.stereoChain.get<ChainPositions::Reverb1>().reset(); break;
+        case Reverb2Stage: chain.stereoChain.get<ChainPositions::Reverb2>().reset(); break;
+
+        case ChorusStage:
+            chain.stereoChain.get<ChainPositions::Chorus1>().reset();
+            chain.stereoChain.get<ChainPositions::Chorus2>().reset();
+            chain.modulationOversampler.reset();
+            break;
+
+        case FilterStage:
+            chain.stereoChain.get<ChainPositions::LowPass>().reset();
+            chain.stereoChain.get<ChainPositions::HighPass>().reset();
+            break;
+    }
+}
+
+void MarsAudioProcessor::processChain(PreparedChain& chain, juce::dsp::AudioBlock<float>& block)
+{
+    juce::dsp::ProcessContextReplacing<float> context(block);
+
+    if (chain.mixesDry)
+        chain.dryWetMixer.pushDrySamples(block);
+
+    runMeteredStage(chain, DelayStage, block, [&] { chain.feedbackDelay.process(context); });
+
+    //stereoChain.process(context);
+
+    processReverbs(chain, block);
+
+    runMeteredStage(chain, ChorusStage, block, [&]
+    {
+        if (chain.modulationOversampler.isActive())
+        {
+            auto oversampledBlock = chain.modulationOversampler.processSamplesUp(block);
+            processModulation(chain, oversampledBlock);
+            chain.modulationOversampler.processSamplesDown(block);
+        }
+        else
+        {
+            processModulation(chain, block);
+        }
+    });
+
+    runMeteredStage(chain, FilterStage, block, [&]
+    {
+        runElidableStage(chain, LowPass, block, 1.0f, [&](auto&) { chain.stereoChain.get<ChainPositions::LowPass>().process(context); });
+        runElidableStage(chain, HighPass, block, 1.0f, [&](auto&) { chain.stereoChain.get<ChainPositions::HighPass>().process(context); });
+    });
+
+    if (chain.mixesDry)
+    {
+        chain.dryWetMixer.mixWetSamples(block);
+        chain.dryWetRamp.skip((int)block.getNumSamples());
+        chain.mixesDry = chain.dryWetRamp.getTargetValue() < 1.0f || chain.dryWetRamp.isSmoothing();
+    }
+}
+
+// both chains see the same input, the old one's output fades out linearly under the new one's
+void MarsAudioProcessor::processChainCrossfade(juce::dsp::AudioBlock<float>& block)
+{
+    auto& fading = *fadingChain;
+    const auto numChannels = block.getNumChannels();
+    const auto numSamples = (int)block.getNumSamples();
+
+    jassert(numSamples <= fading.crossfadeBuffer.getNumSamples() && (int)numChannels <= fading.crossfadeBuffer.getNumChannels());
+
+    auto fadingBlock = juce::dsp::AudioBlock<float>(fading.crossfadeBuffer).getSubsetChannelBlock(0, numChannels)
+                                                                           .getSubBlock(0, (size_t)numSamples);
+    fadingBlock.copyFrom(block);
+
+    processChain(fading, fadingBlock);
+    processChain(getChain(), block);
+
+    const auto step = 1.0f / (float)chainFadeLength;
+    const auto startGain = (float)(chainFadeLength - chainFadeRemaining) * step;
+
+    for (size_t ch = 0; ch < numChannels; ++ch)
+    {
+        auto* output = block.getChannelPointer(ch);
+        const auto* old = fadingBlock.getChannelPointer(ch);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto gain = juce::jmin(1.0f, startGain + (float)i * step);
+            output[i] = old[i] + gain * (output[i] - old[i]);
+        }
+    }
+
+    chainFadeRemaining = juce::jmax(0, chainFadeRemaining - numSamples);
+
+    // swapInPreparedChain waits for an empty retiredChain, so the timer can take it from here
+    if (chainFadeRemaining == 0)
+    {
+        retiredChain = fadingChain;
+        fadingChain = nullptr;
+    }
+}
+
+void MarsAudioProcessor::processReverbs(PreparedChain& chain, juce::dsp::AudioBlock<float>& block)
+{
+    auto& reverb1 = chain.stereoChain.get<ChainPositions::Reverb1>();
+    auto& reverb2 = chain.stereoChain.get<ChainPositions::Reverb2>();
+
+    auto runReverb = [this, &chain](ChainPositions position, ReverbSlot& reverb, juce::dsp::AudioBlock<float>& stageBlock)
+    {
+        runElidableStage(chain, position, stageBlock, reverb.getDryGain(), [&reverb](auto& elidedBlock)
+        {
+            reverb.process(juce::dsp::ProcessContextReplacing<float>(elidedBlock));
+        });
+    };
+
+    const auto parallel = chain.parallelRouting;
+
+    if (parallel <= 0.0f)
+    {
+        runMeteredStage(chain, Reverb1Stage, block, [&] { runReverb(Reverb1, reverb1, block); });
+        runMeteredStage(chain, Reverb2Stage, block, [&] { runReverb(Reverb2, reverb2, block); });
+        return;
+    }
+
+    // Reverb2 listens to the input the way Reverb1 does, or on the way between the routings
+    // to a blend of that and Reverb1's output. With the reverbs' dry levels scaled down by
+    // the same amount, out = parallel * Reverb1 + Reverb2 is continuous across the ramp
+    auto branch = juce::dsp::AudioBlock<float>(chain.branchBuffer).getSubsetChannelBlock(0, block.getNumChannels())
+                                                                  .getSubBlock(0, block.getNumSamples());
+    branch.copyFrom(block);
+
+    runMeteredStage(chain, Reverb1Stage, block, [&] { runReverb(Reverb1, reverb1, block); });
+
+    if (parallel < 1.0f)
+        branch.multiplyBy(parallel).addProductOf(block, 1.0f - parallel);
+
+    runMeteredStage(chain, Reverb2Stage, branch, [&] { runReverb(Reverb2, reverb2, branch); });
+
+    if (parallel < 1.0f)
+        block.multiplyBy(parallel);
+
+    block.add(branch);
+}
+
+void MarsAudioProcessor::processModulation(PreparedChain& chain, juce::dsp::AudioBlock<float>& block)
+{
+    auto& chorus1 = chain.stereoChain.get<ChainPositions::Chorus1>();
+    auto& chorus2 = chain.stereoChain.get<ChainPositions::Chorus2>();
+    const auto& bypass1 = chain.bypasses[Chorus1];
+    const auto& bypass2 = chain.bypasses[Chorus2];
+
+    generateModulation(chain, (int)block.getNumSamples());
+
+    const auto* lfo1Left = chain.lfoBank.getOutput(LfoBank::chorus1Left);
+    const auto* lfo1Right = chain.lfoBank.getOutput(LfoBank::chorus1Right);
+    const auto* lfo2Left = chain.lfoBank.getOutput(LfoBank::chorus2Left);
+    const auto* lfo2Right = chain.lfoBank.getOutput(LfoBank::chorus2Right);
+
+    // the chorus keeps a voice per side, so while bouncing the right side goes to the worker.
+    // A fade works on the whole block, so it waits until neither chorus is fading
+    if (bounceEngine.isActive() && block.getNumChannels() == 2
+        && (int)block.getNumSamples() >= BounceEngine::minimumParallelSamples
+        && ! bypass1.isFading() && ! bypass2.isFading())
+    {
+        const auto run1 = bypass1.isActive(), run2 = bypass2.isActive();
+
+        if (run1 || run2)
+            bounceEngine.runInParallel([&] { if (run1) chorus1.processChannel(block, 0, lfo1Left); if (run2) chorus2.processChannel(block, 0, lfo2Left); },
+                                       [&] { if (run1) chorus1.processChannel(block, 1, lfo1Right); if (run2) chorus2.processChannel(block, 1, lfo2Right); });
+        return;
+    }
+
+    runElidableStage(chain, Chorus1, block, 1.0f, [&](auto&) { chorus1.process(block, lfo1Left, lfo1Right); });
+    runElidableStage(chain, Chorus2, block, 1.0f, [&](auto&) { chorus2.process(block, lfo2Left, lfo2Right); });
+}
+
+void MarsAudioProcessor::syncModulation() noexcept
+{
+    auto& lfoBank = getChain().lfoBank;
+
+    if (! lfoBank.isSynced())
+        return;
+
+    auto* playHead = getPlayHead();
+
+    if (playHead == nullptr)
+        return;
+
+    if (const auto position = playHead->getPosition())
+    {
+        if (const auto bpm = position->getBpm())
+            lfoBank.setTempo(*bpm);
+
+        if (position->getIsPlaying())
+            if (const auto ppq = position->getPpqPosition())
+                lfoBank.syncToPosition(*ppq);
+    }
+}
+
+void MarsAudioProcessor::generateModulation(PreparedChain& chain, int numSamples) noexcept
+{
+    // the choruses run at the oversampled rate, and their LFOs with them
+    const auto rateIndex = chain.stereoChain.get<ChainPositions::Chorus1>().getRateIndex();
+    chain.lfoBank.process(numSamples, chain.spec.sampleRate * (double)(1 << rateIndex));
+}
+
+const char* MarsAudioProcessor::getStageName(Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case Stage::delay:     return "Delay";
+        case Stage::reverb1:   return "Reverb1";
+        case Stage::reverb2:   return "Reverb2";
+        case Stage::chorus1:   return "Chorus1";
+        case Stage::chorus2:   return "Chorus2";
+        case Stage::lowPass:   return "LowPass";
+        case Stage::highPass:  return "HighPass";
+        case Stage::numStages: break;
+    }
+
+    return "";
+}
+
+void MarsAudioProcessor::processStage(Stage stage, juce::dsp::AudioBlock<float>& block)
+{
+    juce::dsp::ProcessContextReplacing<float> context(block);
+    auto& chain = getChain();
+
+    switch (stage)
+    {
+        case Stage::delay:     chain.feedbackDelay.process(context); break;
+        case Stage::reverb1:   chain.stereoChain.get<ChainPositions::Reverb1>().process(context); break;
+        case Stage::reverb2:   chain.stereoChain.get<ChainPositions::Reverb2>().process(context); break;
+        case Stage::lowPass:   chain.stereoChain.get<ChainPositions::LowPass>().process(context); break;
+        case Stage::highPass:  chain.stereoChain.get<ChainPositions::HighPass>().process(context); break;
+
+        case Stage::chorus1:
+        case Stage::chorus2:
+        {
+            auto processChorus = [this, &chain, stage](const juce::dsp::AudioBlock<float>& chorusBlock)
+            {
+                generateModulation(chain, (int)chorusBlock.getNumSamples());
+                const auto& lfoBank = chain.lfoBank;
+
+                if (stage == Stage::chorus1)
+                    chain.stereoChain.get<ChainPositions::Chorus1>().process(chorusBlock, lfoBank.getOutput(LfoBank::chorus1Left),
+                                                                             lfoBank.getOutput(LfoBank::chorus1Right));
+                else
+                    chain.stereoChain.get<ChainPositions::Chorus2>().process(chorusBlock, lfoBank.getOutput(LfoBank::chorus2Left),
+                                                                             lfoBank.getOutput(LfoBank::chorus2Right));
+            };
+
+            if (chain.modulationOversampler.isActive())
+            {
+                auto oversampledBlock = chain.modulationOversampler.processSamplesUp(block);
+                processChorus(oversampledBlock);
+                chain.modulationOversampler.processSamplesDown(block);
+            }
+            else
+            {
+                processChorus(block);
+            }
+            break;
+        }
+
+        case Stage::numStages: break;
+    }
+}
+
+//==============================================================================
+void MarsAudioProcessor::updateChain(ChainSettings& chainSettings)
+{
+    if (chainSettings.hasSameValuesAs(lastChainSettings))
+        return;
+
+    chainSettings.version = ++chainSettingsVersion;
+
+    if (! chainSettings.hasSameFiltersAs(lastChainSettings))
+        updateFilterCoefficients(getChain(), chainSettings);
+
+    applyChainSettings(chainSettings);
+    lastChainSettings = chainSettings;
+}
+
+//==============================================================================
+void MarsAudioProcessor::applyChainSettings(const ChainSettings& chainSettings)
+{
+    applyStageSettings(getChain(), chainSettings);
+    oversamplingLatency.store(getChain().modulationOversampler.getLatencySamples());
+
+    updateTailLength(chainSettings);
+}
+
+void MarsAudioProcessor::applyStageSettings(PreparedChain& chain, const ChainSettings& chainSettings)
+{
+    auto& chorus1 = chain.stereoChain.get<ChainPositions::Chorus1>();
+    auto& chorus2 = chain.stereoChain.get<ChainPositions::Chorus2>();
+
+    chain.feedbackDelay.setParameters(chainSettings.dlTime, chainSettings.dlFeedback, chainSettings.dlMix);
+
+    // the chorus voice has to run at the rate the oversampler hands it
+    if (chainSettings.renderOffline)
+        chain.modulationOversampler.setMode(ModulationOversampler::Tier::offline, chainSettings.osRender);
+    else
+        chain.modulationOversampler.setMode(ModulationOversampler::Tier::realtime, chainSettings.osRealtime);
+
+    const auto chorusRateIndex = chain.modulationOversampler.isActive() ? (int)chain.modulationOversampler.getFactor() : 0;
+    chorus1.setRateIndex(chorusRateIndex);
+    chorus2.setRateIndex(chorusRateIndex);
+
+    juce::dsp::Reverb::Parameters reverb1Parameters, reverb2Parameters;
+
     reverb1Parameters.roomSize = chainSettings.reverb1Mix;
     reverb1Parameters.damping = 0.33f;
-    reverb1Parameters.wetLevel = chainSettings.reverb1Mix;
-    reverb1Parameters.dryLevel = 1.f + (-1.f * chainSettings.reverb1Mix);
+    reverb1Parameters.wetLevel = chainSettings.reverb1Mix * getStereoReverbWetScale(reverb1Parameters.width);
+    reverb1Parameters.dryLevel = (1.f + (-1.f * chainSettings.reverb1Mix)) * (1.f - chainSettings.parallelRouting);
     reverb1Parameters.freezeMode = chainSettings.reverb1Amount * 0.3f;
 
-    leftChain.get<ChainPositions::Chorus1>().setFeedback(-0.2999f);
-    rightChain.get<ChainPositions::Chorus1>().setFeedback(-0.3001f);
-    leftChain.get<ChainPositions::Chorus1>().setMix(chainSettings.reverb1Mix * 0.33f);
-    rightChain.get<ChainPositions::Chorus1>().setMix(chainSettings.reverb1Mix * 0.33f);
-    leftChain.get<ChainPositions::Chorus1>().setDepth(chainSettings.reverb1ModDepth);
-    rightChain.get<ChainPositions::Chorus1>().setDepth(chainSettings.reverb1ModDepth);
-    leftChain.get<ChainPositions::Chorus1>().setRate(chainSettings.reverb1ModRate - 0.001);
-    rightChain.get<ChainPositions::Chorus1>().setRate(chainSettings.reverb1ModRate);
+    chorus1.setFeedback(-0.2999f, -0.3001f);
+    chorus1.setMix(chainSettings.reverb1Mix * 0.33f);
+    chorus1.setDepth(chainSettings.reverb1ModDepth);
 
     reverb2Parameters.roomSize = chainSettings.reverb2Mix;
     reverb2Parameters.damping = 0.71f;
-    reverb2Parameters.wetLevel = chainSettings.reverb2Mix;
-    reverb2Parameters.dryLevel = 1.f + (-1.f * chainSettings.reverb2Amount);
+    reverb2Parameters.wetLevel = chainSettings.reverb2Mix * getStereoReverbWetScale(reverb2Parameters.width);
+    reverb2Parameters.dryLevel = (1.f + (-1.f * chainSettings.reverb2Amount)) * (1.f - chainSettings.parallelRouting);
     reverb2Parameters.freezeMode = chainSettings.reverb2Amount * 0.3f;
 
-    leftChain.get<ChainPositions::Chorus2>().setFeedback(0.2887f);
-    rightChain.get<ChainPositions::Chorus2>().setFeedback(0.3112f);
-    leftChain.get<ChainPositions::Chorus2>().setMix(chainSettings.reverb2Mix * 0.33f);
-    rightChain.get<ChainPositions::Chorus2>().setMix(chainSettings.reverb2Mix * 0.33f);
-    leftChain.get<ChainPositions::Chorus2>().setDepth(chainSettings.reverb1ModDepth);
-    rightChain.get<ChainPositions::Chorus2>().setDepth(chainSettings.reverb1ModDepth);
-    leftChain.get<ChainPositions::Chorus2>().setRate(chainSettings.reverb1ModRate - 0.001);
-    rightChain.get<ChainPositions::Chorus2>().setRate(chainSettings.reverb1ModRate);
+    chorus2.setFeedback(0.2887f, 0.3112f);
+    chorus2.setMix(chainSettings.reverb2Mix * 0.33f);
+    chorus2.setDepth(chainSettings.reverb1ModDepth);
 
-    leftChain.get<ChainPositions::Reverb1>().setParameters(reverb1Parameters);
-    rightChain.get<ChainPositions::Reverb1>().setParameters(reverb1Parameters);
+    chain.stereoChain.get<ChainPositions::Reverb1>().setAlgorithm(chainSettings.reverb1Algorithm);
+    chain.stereoChain.get<ChainPositions::Reverb2>().setAlgorithm(chainSettings.reverb2Algorithm);
 
-    leftChain.get<ChainPositions::Reverb2>().setParameters(reverb2Parameters);
-    rightChain.get<ChainPositions::Reverb2>().setParameters(reverb2Parameters);
+    // a bounce waits for the convolution tails instead of dropping the late ones
+    chain.stereoChain.get<ChainPositions::Reverb1>().convolution.setNonRealtime(chainSettings.renderOffline);
+    chain.stereoChain.get<ChainPositions::Reverb2>().convolution.setNonRealtime(chainSettings.renderOffline);
 
-    auto lowpassCoefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(UniversalSampleRate, chainSettings.masterHighpass);
-    auto highpassCoefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(UniversalSampleRate, chainSettings.masterLowpass);
+    chain.stereoChain.get<ChainPositions::Reverb1>().setParameters(reverb1Parameters);
+    chain.stereoChain.get<ChainPositions::Reverb2>().setParameters(reverb2Parameters);
 
-    *leftChain.get<ChainPositions::LowPass>().coefficients = *lowpassCoefficients;
-    *rightChain.get<ChainPositions::LowPass>().coefficients = *lowpassCoefficients;
+    chain.parallelRouting = chainSettings.parallelRouting;
 
-    *leftChain.get<ChainPositions::HighPass>().coefficients = *highpassCoefficients;
-    *rightChain.get<ChainPositions::HighPass>().coefficients = *highpassCoefficients;
+    // the left LFOs run 0.001 Hz slow so the sides drift apart; synced they share the beat
+    chain.lfoBank.setShape(chainSettings.modShape);
+    chain.lfoBank.setSync(chainSettings.modSync);
+    chain.lfoBank.setRate(LfoBank::chorus1Left, chainSettings.reverb1ModRate - 0.001f);
+    chain.lfoBank.setRate(LfoBank::chorus1Right, chainSettings.reverb1ModRate);
+    chain.lfoBank.setRate(LfoBank::chorus2Left, chainSettings.reverb1ModRate - 0.001f);
+    chain.lfoBank.setRate(LfoBank::chorus2Right, chainSettings.reverb1ModRate);
 
-    //linkChainSettings(chainSettings);
-    
-    juce::dsp::AudioBlock<float> block(buffer);
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    // fully wet there's no dry path to run; it starts again from a cleared delay line,
+    // and the mix ramps away from 1 from there. On the way to 1 it keeps running until
+    // the mixer's ramp has arrived, processChain drops it then
+    const auto shouldMixDry = chainSettings.masterDryWet < 1.0f;
+
+    if (shouldMixDry && ! chain.mixesDry)
+        chain.dryWetMixer.reset();
 
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    chain.dryWetMixer.setWetMixProportion(chainSettings.masterDryWet);
+    chain.dryWetRamp.setTargetValue(chainSettings.masterDryWet);
+    chain.mixesDry = shouldMixDry || chain.dryWetRamp.isSmoothing();
 
-    //leftChain.process(leftContext);
-    //rightChain.process(rightContext);
+    jassert(chain.modulationOversampler.getLatencySamples() <= maximumDryLatencySamples);
+    chain.dryWetMixer.setWetLatency((float)chain.modulationOversampler.getLatencySamples());
 
-    leftChain.get<ChainPositions::Reverb1>().process(leftContext);
-    rightChain.get<ChainPositions::Reverb1>().process(rightContext);
-    leftChain.get<ChainPositions::Reverb2>().process(leftContext);
-    rightChain.get<ChainPositions::Reverb2>().process(rightContext);
-    leftChain.get<ChainPositions::Chorus1>().process(leftContext);
-    rightChain.get<ChainPositions::Chorus1>().process(rightContext);
-    leftChain.get<ChainPositions::Chorus2>().process(leftContext);
-    rightChain.get<ChainPositions::Chorus2>().process(rightContext);
-    leftChain.get<ChainPositions::LowPass>().process(leftContext);
-    rightChain.get<ChainPositions::LowPass>().process(rightContext);
-    leftChain.get<ChainPositions::HighPass>().process(leftContext);
-    rightChain.get<ChainPositions::HighPass>().process(rightContext);
+    updateStageBypasses(chain, chainSettings);
 }
 
-//==============================================================================
+juce::uint32 MarsAudioProcessor::getActiveStages(const ChainSettings& chainSettings, double sampleRate) noexcept
+{
+    // With its mix at 0 a reverb only scales the dry signal and a chorus passes it through.
+    // A filter only goes out where its response is flat across the audible band; the ends of
+    // the Low Cut and High Cut ranges are not (20 kHz is still -3 dB at 20 kHz), so the stock
+    // settings keep both. The oversampler's latency stays in the path either way, so leaving
+    // the choruses out never moves it
+    const auto filterOrder = 2 * CascadedFilter::getNumSections(chainSettings.filterSlope);
 
+    juce::uint32 activeStages = 0;
 
+    auto setActive = [&activeStages](ChainPositions position, bool isActive)
+    {
+        if (isActive)
+            activeStages |= 1u << position;
+    };
+
+    setActive(Reverb1, chainSettings.reverb1Mix > 0.0f);
+    setActive(Chorus1, chainSettings.reverb1Mix > 0.0f);
+    setActive(Reverb2, chainSettings.reverb2Mix > 0.0f);
+    setActive(Chorus2, chainSettings.reverb2Mix > 0.0f);
+    setActive(LowPass, ! isFilterInaudible(true, chainSettings.masterHighpass, filterOrder, sampleRate));
+    setActive(HighPass, ! isFilterInaudible(false, chainSettings.masterLowpass, filterOrder, sampleRate));
+
+    return activeStages;
+}
 
+void MarsAudioProcessor::updateStageBypasses(PreparedChain& chain, const ChainSettings& chainSettings) noexcept
+{
+    const auto activeStages = getActiveStages(chainSettings, chain.spec.sampleRate);
 
-//==============================================================================
-//void MarsAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-//{
-//    // You should use this method to store your parameters in the memory block.
-//    // You could do that either as raw data, or use the XML or ValueTree classes
-//    // as intermediaries to make it easy to save and load complex data.
-//}
-//
-//void MarsAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-//{
-//    // You should use this method to restore your parameters from this memory block,
-//    // whose contents will have been created by the getStateInformation() call.
-//}
+    // a stage coming back starts clean and fades in from its bypassed output
+    for (int position = 0; position < NumChainPositions; ++position)
+        if (chain.bypasses[(size_t)position].setActive(((activeStages >> position) & 1u) != 0))
+            resetChainStage(chain, (ChainPositions)position);
+}
+
+void MarsAudioProcessor::resetChainStage(PreparedChain& chain, ChainPositions position) noexcept
+{
+    switch (position)
+    {
+        case Reverb1:  chain.stereoChain.get<ChainPositions::Reverb1>().reset(); break;
+        case Chorus1:  chain.stereoChain.get<ChainPositions::Chorus1>().reset(); break;
+        case Reverb2:  chain.stereoChain.get<ChainPositions::Reverb2>().reset(); break;
+        case Chorus2:  chain.stereoChain.get<ChainPositions::Chorus2>().reset(); break;
+        case LowPass:  chain.stereoChain.get<ChainPositions::LowPass>().reset(); break;
+        case HighPass: chain.stereoChain.get<ChainPositions::HighPass>().reset(); break;
+        case NumChainPositions: break;
+    }
+}
+
+void MarsAudioProcessor::updateTailLength(const ChainSettings& chainSettings)
+{
+    // the stages run in series, so their tails add up
+    const auto& chain = getChain();
+    const auto delayTail = FeedbackDelay::getTailSeconds(chainSettings.dlTime, chainSettings.dlFeedback, chainSettings.dlMix);
+    const auto tail = delayTail
+                    + chain.stereoChain.get<ChainPositions::Reverb1>().getTailSeconds()
+                    + chain.stereoChain.get<ChainPositions::Reverb2>().getTailSeconds()
+                    + chainTailMarginSeconds
+                    + chain.modulationOversampler.getLatencySamples() / chain.spec.sampleRate;
+
+    // an echo can come back after a whole delay time of quiet
+    const auto longestGap = (chainSettings.dlMix > 0.0f ? chainSettings.dlTime : 0.0) + chainTailMarginSeconds;
+
+    tailLengthSeconds.store(tail);
+    silenceGate.setTail(tail, longestGap);
+}
+
+void MarsAudioProcessor::updateFilterCoefficients(PreparedChain& chain, const ChainSettings& chainSettings)
+{
+    // a table lookup per filter, nothing is designed or allocated here. The Low Cut knob
+    // (masterHighpass) drives the LowPass stage and vice versa, that is how processBlock
+    // has always wired them.
+    auto& lowPass = chain.stereoChain.get<ChainPositions::LowPass>();
+    auto& highPass = chain.stereoChain.get<ChainPositions::HighPass>();
+
+    lowPass.setSlope(chainSettings.filterSlope);
+    highPass.setSlope(chainSettings.filterSlope);
+
+    lowPass.setCutoff(chainSettings.masterHighpass);
+    highPass.setCutoff(chainSettings.masterLowpass);
+}
 
 //==============================================================================
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts) {
-    ChainSettings settings;
+namespace
+{
+    const juce::Identifier programProperty{ "program" };
+    const juce::Identifier impulseResponseProperties[] = { "impulseResponse1", "impulseResponse2" };
+}
+
+void MarsAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    foleys::MagicProcessor::getStateInformation(destData);
+
+    // magicState writes a copy of the apvts tree, so what isn't a parameter rides along as
+    // properties of that copy; the live tree is left alone, the host may call this from any thread
+    auto state = juce::ValueTree::readFromData(destData.getData(), destData.getSize());
+
+    if (! state.isValid())
+        return;
 
-    //settings.dlTime = apvts.getRawParameterValue("dlTime")->load();
-    //settings.dlFeedback = apvts.getRawParameterValue("dlFeedback")->load();
+    removeReadouts(state);
+    state.setProperty(programProperty, currentProgram, nullptr);
 
-    settings.reverb1Amount = apvts.getRawParameterValue("reverb1Amount")->load();
-    settings.reverb1Mix = apvts.getRawParameterValue("reverb1Mix")->load();
-    settings.reverb1ModDepth = apvts.getRawParameterValue("reverb1ModDepth")->load();
-    settings.reverb1ModRate = apvts.getRawParameterValue("reverb1ModRate")->load();
+    // the file asked for last, even if the loader hasn't finished with it yet
+    for (int slot = 0; slot < 2; ++slot)
+        state.setProperty(impulseResponseProperties[slot], impulseResponseFiles[slot].getFullPathName(), nullptr);
 
-    settings.reverb2Amount = apvts.getRawParameterValue("reverb2Amount")->load();
-    settings.reverb2Mix = apvts.getRawParameterValue("reverb2Mix")->load();
-    settings.reverb2ModDepth = apvts.getRawParameterValue("reverb2ModDepth")->load();
-    settings.reverb2ModRate = apvts.getRawParameterValue("reverb2ModRate")->load();
+    destData.reset();
+    juce::MemoryOutputStream stream(destData, false);
+    state.writeToStream(stream);
+}
+
+void MarsAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    // replaces the apvts tree, the parameters follow through their listeners
+    foleys::MagicProcessor::setStateInformation(data, sizeInBytes);
+
+    currentProgram = juce::jlimit(0, presetBank.getNumPresets() - 1, (int)apvts.state.getProperty(programProperty, 0));
+
+    for (int slot = 0; slot < 2; ++slot)
+    {
+        const auto path = apvts.state.getProperty(impulseResponseProperties[slot]).toString();
 
-    settings.masterHighpass = apvts.getRawParameterValue("masterHighpass")->load();
-    settings.masterLowpass = apvts.getRawParameterValue("masterLowpass")->load();
-    //settings.masterDryWet = apvts.getRawParameterValue("dryWetMix")->load();
+        if (path.isNotEmpty() && juce::File::isAbsolutePath(path) && juce::File(path) != getImpulseResponseFile(slot))
+            loadImpulseResponse(slot, juce::File(path));
+    }
+}
+
+//==============================================================================
+bool ChainSettings::hasSameValuesAs(const ChainSettings& other) const noexcept
+{
+    return dlTime == other.dlTime
+        && dlFeedback == other.dlFeedback
+        && dlMix == other.dlMix
+        && reverb1Amount == other.reverb1Amount
+        && reverb1Mix == other.reverb1Mix
+        && reverb1ModRate == other.reverb1ModRate
+        && reverb1ModDepth == other.reverb1ModDepth
+        && reverb2Amount == other.reverb2Amount
+        && reverb2Mix == other.reverb2Mix
+        && reverb2ModRate == other.reverb2ModRate
+        && reverb2ModDepth == other.reverb2ModDepth
+        && masterDryWet == other.masterDryWet
+        && parallelRouting == other.parallelRouting
+        && modShape == other.modShape
+        && modSync == other.modSync
+        && reverb1Algorithm == other.reverb1Algorithm
+        && reverb2Algorithm == other.reverb2Algorithm
+        && osRealtime == other.osRealtime
+        && osRender == other.osRender
+        && renderOffline == other.renderOffline
+        && hasSameFiltersAs(other);
+}
+
+bool ChainSettings::hasSameFiltersAs(const ChainSettings& other) const noexcept
+{
+    return masterHighpass == other.masterHighpass
+        && masterLowpass == other.masterLowpass
+        && filterSlope == other.filterSlope;
+}
+
+template <typename ParameterSource>
+ChainSettings getChainSettings(const ParameterSource& parameters) {
+    ChainSettings settings;
+
+    settings.dlTime = parameters.get(ParameterId::dlTime);
+    settings.dlFeedback = parameters.get(ParameterId::dlFeedback);
+    settings.dlMix = parameters.get(ParameterId::dlMix);
+
+    settings.reverb1Amount = parameters.get(ParameterId::reverb1Amount);
+    settings.reverb1Mix = parameters.get(ParameterId::reverb1Mix);
+    settings.reverb1ModDepth = parameters.get(ParameterId::reverb1ModDepth);
+    settings.reverb1ModRate = parameters.get(ParameterId::reverb1ModRate);
+
+    settings.reverb2Amount = parameters.get(ParameterId::reverb2Amount);
+    settings.reverb2Mix = parameters.get(ParameterId::reverb2Mix);
+    settings.reverb2ModDepth = parameters.get(ParameterId::reverb2ModDepth);
+    settings.reverb2ModRate = parameters.get(ParameterId::reverb2ModRate);
+
+    settings.masterHighpass = parameters.get(ParameterId::masterHighpass);
+    settings.masterLowpass = parameters.get(ParameterId::masterLowpass);
+
+    settings.reverb1Algorithm = static_cast<ReverbAlgorithm>(juce::roundToInt(parameters.get(ParameterId::reverb1Algorithm)));
+    settings.reverb2Algorithm = static_cast<ReverbAlgorithm>(juce::roundToInt(parameters.get(ParameterId::reverb2Algorithm)));
+    settings.osRealtime = static_cast<ModulationOversampler::Factor>(juce::roundToInt(parameters.get(ParameterId::osRealtime)));
+    settings.osRender = static_cast<ModulationOversampler::Factor>(juce::roundToInt(parameters.get(ParameterId::osRender)));
+    settings.filterSlope = static_cast<CascadedFilter::Slope>(juce::roundToInt(parameters.get(ParameterId::filterSlope)));
+    settings.masterDryWet = parameters.get(ParameterId::dryWetMix);
+    settings.parallelRouting = parameters.get(ParameterId::reverbRouting);
+    settings.modShape = static_cast<LfoBank::Shape>(juce::roundToInt(parameters.get(ParameterId::modShape)));
+    settings.modSync = juce::roundToInt(parameters.get(ParameterId::modSync));
 
     return settings;
 }
 
+template ChainSettings getChainSettings(const ParameterHandles&);
+template ChainSettings getChainSettings(const Preset&);
+
 
 juce::AudioProcessorValueTreeState::ParameterLayout MarsAudioProcessor::createParameterLayout() {
 
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
 
-    //layout.add(std::make_unique<juce::AudioParameterFloat>(
-    //    "dlTime", //parameterId
-    //    "Delay Time", //parameter name
-    //    juce::NormalisableRange<float>(
-    //        0.1f, //minvalue
-    //        5.0f, //max value
-    //        0.1f, //interval
-    //        0.5f//range with a skew factor
-    //        ),
-    //    2.f//default value
-    //    )
-    //);
-
-    //layout.add(std::make_unique<juce::AudioParameterFloat>(
-    //    "dlFeedback", //parameterId
-    //    "Delay Feedback", //parameter name
-    //    juce::NormalisableRange<float>(
-    //        0.0f, //minvalue
-    //        0.8f, //max value
-    //        0.05f, //interval
-    //        1.f//range with a skew factor
-    //        ),
-    //    0.5f//default value
-    //    )
-    //);
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "masterHighpass", //parameterId
-        "Low Cut", //parameter name
-        juce::NormalisableRange<float>(
-            20.0f, //minvalue
-            20000.0f, //max value
-            1.f, //interval
-            0.35f//range with a skew factor
-            ),
-        20000.f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "masterLowpass", //parameterId
-        "High Cut", //parameter name
-        juce::NormalisableRange<float>(
-            20.0f, //minvalue
-            20000.f, //max value
-            1.f, //interval
-            0.35f//range with a skew factor
-            ),
-        20.f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb1Amount", //parameterId
-        "Rev 1 Amount", //parameter name
-        juce::NormalisableRange<float>(
-            0.05f, //minvalue
-            1.f, //max value
-            0.05f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb1Mix", //parameterId
-        "Rev 1 Mix", //parameter name
-        juce::NormalisableRange<float>(
-            0.0f, //minvalue
-            1.0f, //max value
-            0.05f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb1ModRate", //parameterId
-        "Rev 1 Mod Rate", //parameter name
-        juce::NormalisableRange<float>(
-            0.002f, //minvalue
-            10.f, //max value
-            0.005f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb1ModDepth", //parameterId
-        "Rev 1 ModDepth", //parameter name
-        juce::NormalisableRange<float>(
-            0.0f, //minvalue
-            1.0f, //max value
-            0.05f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb2Amount", //parameterId
-        "Rev 2 Amount", //parameter name
-        juce::NormalisableRange<float>(
-            0.05f, //minvalue
-            1.f, //max value
-            0.05f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb2Mix", //parameterId
-        "Rev 2 Mix", //parameter name
-        juce::NormalisableRange<float>(
-            0.0f, //minvalue
-            1.0f, //max value
-            0.05f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb2ModRate", //parameterId
-        "Rev 2 Mod Rate", //parameter name
-        juce::NormalisableRange<float>(
-            0.002f, //minvalue
-            10.f, //max value
-            0.005f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-        "reverb2ModDepth", //parameterId
-        "Rev 2 ModDepth", //parameter name
-        juce::NormalisableRange<float>(
-            0.0f, //minvalue
-            1.0f, //max value
-            0.05f, //interval
-            1.f//range with a skew factor
-            ),
-        0.5f//default value
-        )
-    );
-
-    //layout.add(std::make_unique<juce::AudioParameterFloat>(
-    //    "dryWetMix", //parameterId
-    //    "Dry Wet Mix", //parameter name
-    //    juce::NormalisableRange<float>(
-    //        0.0f, //minvalue
-    //        1.0f, //max value
-    //        0.05f, //interval
-    //        1.f//range with a skew factor
-    //        ),
-    //    0.5f//default value
-    //    )
-    //);
-
-    /*juce::StringArray algoList;
-    algoList.add("Hall");
-
-    layout.add(std::make_unique <juce::AudioParameterChoice>(
-        "Reverb 1",
-        "Reverb 1",
-        algoList,
-        0
-        )
-    );*/
+    for (const auto& parameter : parameterSpecs)
+    {
+        if (parameter.choices != nullptr)
+        {
+            layout.add(std::make_unique<juce::AudioParameterChoice>(
+                parameter.id, //parameterId
+                parameter.name, //parameter name
+                juce::StringArray::fromTokens(parameter.choices, "|", ""),
+                (int)parameter.defaultValue//default index
+                )
+            );
+            continue;
+        }
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(
+            parameter.id, //parameterId
+            parameter.name, //parameter name
+            juce::NormalisableRange<float>(
+                parameter.minValue, //minvalue
+                parameter.maxValue, //max value
+                parameter.interval, //interval
+                parameter.skew//range with a skew factor
+                ),
+            parameter.defaultValue//default value
+            )
+        );
+    }
 
     return layout;
 }
@@ -9,11 +9,63 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "AllocationCounter.h"
+#include "ParameterIds.h"
+#include "ParameterSmoothing.h"
+#include "StereoChorus.h"
+#include "ReverbSlot.h"
+#include "FeedbackDelay.h"
+#include "ModulationOversampler.h"
+#include "BounceEngine.h"
+#include "DspLoadMeter.h"
+#include "DspLoadPlot.h"
+#include "SignalAnalyser.h"
+#include "AnalysisPlots.h"
+#include "SilenceGate.h"
+#include "HealthMonitor.h"
+#include "CascadedFilter.h"
+#include "PresetBank.h"
+#include "StageBypass.h"
+#include "LfoBank.h"
+
+//==============================================================================
+struct ChainSettings {
+    float dlFeedback{ 0 }, dlTime{ 0 }, dlMix{ 0 };
+    float reverb1Amount{ 0 }, reverb1Mix{ 0 }, reverb1ModRate{ 0 }, reverb1ModDepth{ 0 };
+    float reverb2Amount{ 0 }, reverb2Mix{ 0 }, reverb2ModRate{ 0 }, reverb2ModDepth{ 0 };
+    float masterHighpass{ 0 }, masterLowpass{ 0 }, masterDryWet{ 0 };
+    ReverbAlgorithm reverb1Algorithm{ ReverbAlgorithm::classic }, reverb2Algorithm{ ReverbAlgorithm::classic };
+    CascadedFilter::Slope filterSlope{ CascadedFilter::Slope::db12 };
+
+    // 0 runs Reverb2 on Reverb1's output, 1 runs both on the same input and sums their wet
+    // signals; it ramps like the other parameters, so in between the two routings blend
+    float parallelRouting{ 0 };
+
+    // chorus LFO shape and note length, sync 0 runs them at the Mod Rate
+    LfoBank::Shape modShape{ LfoBank::Shape::sine };
+    int modSync{ 0 };
+
+    // chorus oversampling per tier, renderOffline picks which one is in use
+    ModulationOversampler::Factor osRealtime{ ModulationOversampler::Factor::off }, osRender{ ModulationOversampler::Factor::off };
+    bool renderOffline{ false };
+
+    // bumped every time a snapshot differs from the one before it, 0 means "never applied"
+    juce::uint32 version{ 0 };
+
+    bool hasSameValuesAs(const ChainSettings& other) const noexcept;
+    bool hasSameFiltersAs(const ChainSettings& other) const noexcept;
+};
+
+// reads every parameter through get(ParameterId), instantiated for ParameterHandles and Preset
+template <typename ParameterSource>
+ChainSettings getChainSettings(const ParameterSource&);
+void linkChainSettings(ChainSettings);
 
 //==============================================================================
 /**
 */
-class MarsAudioProcessor  : public foleys::MagicProcessor //: public juce::AudioProcessor
+class MarsAudioProcessor  : public foleys::MagicProcessor, //: public juce::AudioProcessor
+                            private juce::Timer
 {
 public:
     //==============================================================================
@@ -30,6 +82,9 @@ public:
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+    // starts or stops the bounce worker
+    void setNonRealtime (bool isNonRealtime) noexcept override;
+
     //==============================================================================
 
     //==============================================================================
@@ -47,33 +102,83 @@ public:
     const juce::String getProgramName (int index) override;
     void changeProgramName (int index, const juce::String& newName) override;
 
+    // factory presets first, then the user presets found in the preset folder
+    PresetBank& getPresetBank() noexcept { return presetBank; }
+
+    // message thread: stores the current parameters as a user preset and selects it
+    bool saveUserPreset(const juce::String& name);
+
+    // heap held by the DSP, the delay buffer only counts once the delay has been enabled
+    size_t getMemoryFootprintBytes() const noexcept;
+
+    // the chain stages in processing order, for measuring them one at a time
+    enum class Stage
+    {
+        delay,
+        reverb1,
+        reverb2,
+        chorus1,
+        chorus2,
+        lowPass,
+        highPass,
+        numStages
+    };
+
+    static const char* getStageName(Stage stage) noexcept;
+
+    // runs a single stage in place with the current settings, oversampling included for the chorus stages
+    void processStage(Stage stage, juce::dsp::AudioBlock<float>& block);
+
+    // share of the callback deadline processBlock uses, also shown in the GUI as "dspLoad"
+    DspLoadMeter::Snapshot getDspLoad() const noexcept { return dspLoadMeter.getSnapshot(); }
+    void setDspLoadStageTiming(bool shouldTimeStages) noexcept { dspLoadMeter.setStageTimingEnabled(shouldTimeStages); }
+    bool exportDspLoad(const juce::File& file) const;
+
+    // NaN/Inf trips per metered stage, each one silenced and reset that stage for a block
+    const HealthMonitor& getHealthMonitor() const noexcept { return healthMonitor; }
+
+    // spectrum, levels and RT60 of the output, only running while an editor is open
+    const SignalAnalyser& getSignalAnalyser() const noexcept { return signalAnalyser; }
+
+    // impulse response for the Convolution algorithm of reverb slot 0 or 1, loaded in the background
+    bool loadImpulseResponse(int reverbSlot, const juce::File& file);
+    juce::File getImpulseResponseFile(int reverbSlot) const;
+
+    // not the audio thread: waits for both slots to finish loading, false if they took longer than timeoutMs
+    bool waitForImpulseResponses(int timeoutMs) const;
+
+    // samples between two parameter updates while automation is ramping
+    void setSmoothingUpdateInterval(int numSamples) noexcept { chainSmoother.setUpdateInterval(numSamples); }
+    int getSmoothingUpdateInterval() const noexcept { return chainSmoother.getUpdateInterval(); }
+
     //==============================================================================
-    //void getStateInformation (juce::MemoryBlock& destData) override;
-    //void setStateInformation (const void* data, int sizeInBytes) override;
+    // the apvts and the editor settings through magicState, plus the program and the impulse responses
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
 
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts{*this, nullptr, "Parameters", createParameterLayout()};
 
 private:
-    juce::dsp::Reverb::Parameters reverb1Parameters;
-    juce::dsp::Reverb::Parameters reverb2Parameters;
-    using Filter = juce::dsp::IIR::Filter<float>;
-    using DelayLine = juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear>;
-    using SchroederChain = juce::dsp::ProcessorChain<DelayLine,Filter, Filter, Filter, Filter, Filter>;
-    
-    using Reverb = juce::dsp::Reverb;
-    using Chorus = juce::dsp::Chorus<float>;
+    // resolved once here, after apvts exists, so processBlock never looks parameters up by name
+    ParameterHandles parameterHandles{ apvts };
+
+    // Classic (FreeverbCore, SIMD comb lanes), Hall (FdnReverb) or Convolution, picked per slot
+    using Reverb = ReverbSlot;
     using DryWet = juce::dsp::DryWetMixer<float>;
-    using MonoChain = juce::dsp::ProcessorChain< Reverb, Chorus, Reverb, Chorus, Filter, Filter>;
-    
-    MonoChain leftChain, rightChain;
 
-    juce::dsp::ProcessSpec spec;
-    int samplesPerSecond = 2; 
-    juce::AudioBuffer<float> dlAudioBuffer;
-    juce::AudioBuffer<float> dryBuffer;
-    int dlWritePosition{ 0 };
-    float UniversalSampleRate{ 441000 };
+    // well above the 4x FIR oversampler's latency
+    static constexpr int maximumDryLatencySamples = 1024;
+
+    // how long juce::dsp::DryWetMixer ramps between mix settings
+    static constexpr double dryWetRampSeconds = 0.05;
+
+    // 12, 24 or 48 dB/oct, every channel in one pass
+    using MasterFilter = CascadedFilter;
+
+    // one chain for all channels: the reverbs run their own stereo path, the filters run
+    // the channels side by side in SIMD lanes and only the chorus keeps a voice per side
+    using StereoChain = juce::dsp::ProcessorChain< Reverb, MultiRateChorus, Reverb, MultiRateChorus, MasterFilter, MasterFilter>;
 
     enum ChainPositions {
         Reverb1,
@@ -82,7 +187,199 @@ private:
         Chorus2,
         LowPass,
         HighPass,
+        NumChainPositions
     };
+
+    // everything whose buffers or coefficients depend on the spec. The active one is only
+    // ever replaced by the audio thread, and the one it replaces fades out under it and
+    // is then freed by the timer
+    struct PreparedChain
+    {
+        StereoChain stereoChain;
+        FeedbackDelay feedbackDelay;
+
+        // wraps both chorus stages, its latency is handed to the host from timerCallback
+        ModulationOversampler modulationOversampler;
+
+        // the choruses' LFOs, run once per block at whatever rate the choruses run
+        LfoBank lfoBank;
+
+        // one per chain position, a stage with nothing to contribute drops out of processChain.
+        // The scratch holds the bypassed signal during a fade, at up to the 4x chorus rate
+        std::array<StageBypass, NumChainPositions> bypasses;
+        juce::AudioBuffer<float> bypassScratch;
+
+        // Reverb2's input while the reverbs run side by side
+        juce::AudioBuffer<float> branchBuffer;
+        float parallelRouting = 0.0f;
+
+        // this chain's input while it fades out under the one that replaced it
+        juce::AudioBuffer<float> crossfadeBuffer;
+
+        // the chain's input, delayed by the oversampler's latency and mixed back in at the
+        // end. Left out altogether while the mix is fully wet
+        DryWet dryWetMixer{ maximumDryLatencySamples };
+        bool mixesDry = false;
+
+        // follows the mixer's own ramp, which it doesn't expose, so the dry path only
+        // drops out once the mix has actually arrived at fully wet
+        juce::SmoothedValue<float> dryWetRamp;
+
+        // sampleRate stays 0 until the chain has been prepared
+        juce::dsp::ProcessSpec spec{ 0.0, 0, 0 };
+        juce::AudioChannelSet layout;
+
+        bool isPreparedFor(const juce::dsp::ProcessSpec& newSpec, const juce::AudioChannelSet& newLayout) const noexcept;
+        void reset() noexcept;
+    };
+
+    std::atomic<PreparedChain*> activeChain{ new PreparedChain() };
+    std::atomic<PreparedChain*> pendingChain{ nullptr }, retiredChain{ nullptr };
+
+    PreparedChain& getChain() noexcept { return *activeChain.load(std::memory_order_acquire); }
+    const PreparedChain& getChain() const noexcept { return *activeChain.load(std::memory_order_acquire); }
+
+    // audio thread only: the chain activeChain replaced, still running until it has faded out
+    PreparedChain* fadingChain = nullptr;
+    int chainFadeLength = 1, chainFadeRemaining = 0;
+    static constexpr double chainCrossfadeSeconds = 0.05;
+
+    // A new rate or block size is prepared here while the current chain keeps playing;
+    // a build whose generation has been superseded by another prepareToPlay is dropped
+    juce::ThreadPool chainBuilder{ 1 };
+    juce::CriticalSection chainBuildLock;
+    std::atomic<int> chainBuildGeneration{ 0 };
+    juce::dsp::ProcessSpec requestedSpec{ 0.0, 0, 0 };
+    juce::AudioChannelSet requestedLayout;
+
+    // longest a build waits for its convolution slots to load their impulse responses
+    static constexpr int impulseResponseWaitMs = 2000;
+
+    // what the convolution slots should be playing, a newly built chain loads these
+    juce::File impulseResponseFiles[2];
+
+    // what the host asked for last
+    juce::dsp::ProcessSpec spec;
+
+    std::atomic<int> oversamplingLatency{ 0 };
+
+    // only running while the host renders offline
+    BounceEngine bounceEngine;
+
+    // the stages as the load meter and the health monitor see them, the two choruses
+    // and the two filters are handled together
+    enum MeteredStage {
+        DelayStage,
+        Reverb1Stage,
+        Reverb2Stage,
+        ChorusStage,
+        FilterStage,
+    };
+
+    DspLoadMeter dspLoadMeter;
+    HealthMonitor healthMonitor;
+    DspLoadPlot* dspLoadPlot = nullptr; // owned by magicState
+
+    // shown in the GUI as "spectrum", "levels" and "decay", the plots are owned by magicState
+    SignalAnalyser signalAnalyser;
+    SpectrumPlot* spectrumPlot = nullptr;
+    LevelPlot* levelPlot = nullptr;
+    DecayPlot* decayPlot = nullptr;
+
+    // parks the chain once the input is silent and the tail has died away
+    SilenceGate silenceGate;
+    std::atomic<double> tailLengthSeconds{ 0.0 };
+
+    // set by the timer once a newly loaded impulse response changes a slot's tail
+    std::atomic<bool> impulseResponsesChanged{ false };
+    double convolutionTailSeconds[2] = {};
+
+    // allowance for the chorus feedback, the filters and the reverbs' longest loop
+    static constexpr double chainTailMarginSeconds = 0.25;
+    float UniversalSampleRate{ 441000 };
+
+    // The stereo reverb feeds L+R into both comb banks and mixes them with juce::Reverb's
+    // wet1 = (1 + width) / 2 and wet2 = (1 - width) / 2, where each channel used to run its
+    // own mono reverb through wet1 alone. For decorrelated channels L+R carries twice the
+    // energy of one side and the banks add up as wet1^2 + wet2^2, so this scale gives each
+    // output the wet energy its mono reverb had. At width 1 centred material comes out 3 dB
+    // above the old level instead, and the right tail uses Freeverb's stereo-spread tunings.
+    static float getStereoReverbWetScale(float width) noexcept
+    {
+        const auto wet1 = 0.5f * (1.0f + width), wet2 = 0.5f * (1.0f - width);
+        return wet1 / std::sqrt(2.0f * (wet1 * wet1 + wet2 * wet2));
+    }
+
+    // last snapshot pushed into the chain, processBlock only touches the
+    // stages again when a new snapshot differs from this one
+    ChainSettings lastChainSettings;
+    juce::uint32 chainSettingsVersion{ 0 };
+
+    ChainSmoother chainSmoother;
+
+    // A preset switch writes the parameters one by one, so processBlock could catch a
+    // half-written scene. The message thread builds the whole scene as a snapshot and
+    // swaps it in through pendingPreset; processBlock uses it until the parameters have
+    // caught up, and the smoother and the reverb slots' crossfade take it from there.
+    struct PresetSnapshot
+    {
+        ChainSettings settings;
+        int remainingSamples = 0;
+    };
+
+    PresetBank presetBank;
+    int currentProgram{ 0 };
+
+    std::atomic<PresetSnapshot*> pendingPreset{ nullptr }, retiredPreset{ nullptr };
+    std::unique_ptr<PresetSnapshot> activePreset;
+
+    // longest the snapshot overrides the parameters, should the host hold them back
+    static constexpr double presetHoldSeconds = 0.1;
+
+    void applyPreset(int index);
+    void takePresetSnapshot(ChainSettings& chainSettings, int numSamples) noexcept;
+
+    static void prepareChain(PreparedChain& chain, const juce::dsp::ProcessSpec& newSpec,
+                             const juce::AudioChannelSet& newLayout, const ChainSettings& chainSettings);
+    void startChainBuild(const juce::AudioChannelSet& newLayout, const ChainSettings& chainSettings);
+    void cancelChainBuild();
+    void buildChain(int generation, juce::dsp::ProcessSpec newSpec, juce::AudioChannelSet newLayout,
+                    ChainSettings chainSettings, std::array<juce::File, 2> files);
+    void swapInPreparedChain() noexcept;
+
+    void updateChain(ChainSettings& chainSettings);
+    void applyChainSettings(const ChainSettings& chainSettings);
+    static void applyStageSettings(PreparedChain& chain, const ChainSettings& chainSettings);
+    void updateTailLength(const ChainSettings& chainSettings);
+    static void updateFilterCoefficients(PreparedChain& chain, const ChainSettings& chainSettings);
+
+    // a bit per ChainPositions entry, set for the stages that change the signal with these settings
+    static juce::uint32 getActiveStages(const ChainSettings& chainSettings, double sampleRate) noexcept;
+    static void updateStageBypasses(PreparedChain& chain, const ChainSettings& chainSettings) noexcept;
+    static void resetChainStage(PreparedChain& chain, ChainPositions position) noexcept;
+
+    // runs the stage through its bypass, bypassGain is what it reduces to while it's out
+    template <typename Function>
+    void runElidableStage(PreparedChain& chain, ChainPositions position, juce::dsp::AudioBlock<float>& block,
+                          float bypassGain, Function&& function);
+    void processChain(PreparedChain& chain, juce::dsp::AudioBlock<float>& block);
+    void processChainCrossfade(juce::dsp::AudioBlock<float>& block);
+    void processReverbs(PreparedChain& chain, juce::dsp::AudioBlock<float>& block);
+    void processModulation(PreparedChain& chain, juce::dsp::AudioBlock<float>& block);
+
+    // synced LFOs follow the host's tempo and, while the transport runs, its position
+    void syncModulation() noexcept;
+    void generateModulation(PreparedChain& chain, int numSamples) noexcept;
+
+    // times the stage, then checks what it produced and resets it if that wasn't finite
+    template <typename Function>
+    void runMeteredStage(PreparedChain& chain, MeteredStage stage, juce::dsp::AudioBlock<float>& block, Function&& function);
+    void resetMeteredStage(PreparedChain& chain, MeteredStage stage);
+
+    void timerCallback() override;
+    void publishDspLoad();
+    void publishAnalysis();
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MarsAudioProcessor)
 };
@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+namespace
+{
+    const char* const presetTag = "MarsPreset";
+    const char* const parameterTag = "PARAM";
+    const char* const fileExtension = ".marspreset";
+
+    struct FactoryValue
+    {
+        ParameterId parameter;
+        float value;
+    };
+
+    struct FactoryPreset
+    {
+        const char* name;
+        std::initializer_list<FactoryValue> values;
+    };
+
+    // only what differs from the defaults. The Low Cut knob (masterHighpass) drives the
+    // low pass stage, so the darker scenes turn that one down
+    const FactoryPreset factoryPresets[] = {
+        { "Init", {} },
+
+        { "Small Room", { { ParameterId::reverb1Amount, 0.3f },  { ParameterId::reverb1Mix, 0.3f },
+                          { ParameterId::reverb2Mix, 0.0f },     { ParameterId::reverb1ModDepth, 0.1f } } },
+
+        { "Concert Hall", { { ParameterId::reverb1Algorithm, 1.0f }, { ParameterId::reverb1Amount, 0.8f },
+                            { ParameterId::reverb1Mix, 0.4f },       { ParameterId::reverb2Algorithm, 1.0f },
+                            { ParameterId::reverb2Amount, 0.6f },    { ParameterId::reverb2Mix, 0.2f } } },
+
+        { "Dark Wash", { { ParameterId::reverb1Algorithm, 1.0f }, { ParameterId::reverb1Amount, 1.0f },
+                         { ParameterId::reverb1Mix, 0.6f },       { ParameterId::reverb2Amount, 0.9f },
+                         { ParameterId::masterHighpass, 4000.0f } } },
+
+        { "Slapback", { { ParameterId::dlTime, 0.1f },     { ParameterId::dlFeedback, 0.2f },
+                        { ParameterId::dlMix, 0.4f },      { ParameterId::reverb1Mix, 0.15f },
+                        { ParameterId::reverb2Mix, 0.1f } } },
+
+        { "Ambient Echoes", { { ParameterId::dlTime, 0.5f },           { ParameterId::dlFeedback, 0.6f },
+                              { ParameterId::dlMix, 0.35f },           { ParameterId::reverb2Algorithm, 1.0f },
+                              { ParameterId::reverb2Amount, 0.9f },    { ParameterId::reverb2Mix, 0.5f },
+                              { ParameterId::reverb1ModDepth, 0.3f },  { ParameterId::reverb2ModDepth, 0.3f } } },
+    };
+}
+
+//==============================================================================
+Preset Preset::withDefaults(const juce::String& name)
+{
+    Preset preset;
+    preset.name = name;
+
+    for (const auto& spec : parameterSpecs)
+        preset.values[static_cast<size_t>(spec.parameter)] = spec.defaultValue;
+
+    return preset;
+}
+
+void Preset::set(ParameterId parameter, float value) noexcept
+{
+    const auto& spec = getParameterSpec(parameter);
+    values[static_cast<size_t>(parameter)] = juce::jlimit(spec.minValue, spec.maxValue, value);
+}
+
+std::unique_ptr<juce::XmlElement> Preset::toXml() const
+{
+    auto xml = std::make_unique<juce::XmlElement>(presetTag);
+    xml->setAttribute("name", name);
+
+    for (const auto& spec : parameterSpecs)
+    {
+        auto* parameter = xml->createNewChildElement(parameterTag);
+        parameter->setAttribute("id", spec.id);
+        parameter->setAttribute("value", (double)get(spec.parameter));
+    }
+
+    return xml;
+}
+
+Preset Preset::fromXml(const juce::XmlElement& xml)
+{
+    auto preset = withDefaults(xml.getStringAttribute("name"));
+
+    for (auto* parameter : xml.getChildWithTagNameIterator(parameterTag))
+    {
+        const auto id = parameter->getStringAttribute("id");
+
+        for (const auto& spec : parameterSpecs)
+            if (id == spec.id)
+                preset.set(spec.parameter, (float)parameter->getDoubleAttribute("value", spec.defaultValue));
+    }
+
+    return preset;
+}
+
+//==============================================================================
+PresetBank::PresetBank()
+{
+    for (const auto& factory : factoryPresets)
+    {
+        auto preset = Preset::withDefaults(factory.name);
+
+        for (const auto& value : factory.values)
+            preset.set(value.parameter, value.value);
+
+        presets.push_back(std::move(preset));
+    }
+
+    numFactoryPresets = (int)presets.size();
+}
+
+const Preset& PresetBank::getPreset(int index) const
+{
+    jassert(juce::isPositiveAndBelow(index, getNumPresets()));
+    return presets[(size_t)juce::jlimit(0, getNumPresets() - 1, index)];
+}
+
+void PresetBank::renamePreset(int index, const juce::String& newName)
+{
+    if (juce::isPositiveAndBelow(index, getNumPresets()))
+        presets[(size_t)index].name = newName;
+}
+
+juce::File PresetBank::getDefaultUserDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile(JucePlugin_Name)
+               .getChildFile("Presets");
+}
+
+void PresetBank::loadUserPresets(const juce::File& directory)
+{
+    presets.resize((size_t)numFactoryPresets);
+
+    auto files = directory.findChildFiles(juce::File::findFiles, false, juce::String("*") + fileExtension);
+    files.sort();
+
+    for (const auto& file : files)
+        if (auto xml = juce::XmlDocument::parse(file))
+            if (xml->hasTagName(presetTag))
+                presets.push_back(Preset::fromXml(*xml));
+}
+
+int PresetBank::saveUserPreset(const Preset& preset, const juce::File& directory)
+{
+    const auto file = directory.getChildFile(juce::File::createLegalFileName(preset.name) + fileExtension);
+
+    if (! directory.createDirectory() || ! preset.toXml()->writeTo(file))
+        return -1;
+
+    for (int i = numFactoryPresets; i < getNumPresets(); ++i)
+    {
+        if (presets[(size_t)i].name == preset.name)
+        {
+            presets[(size_t)i] = preset;
+            return i;
+        }
+    }
+
+    presets.push_back(preset);
+    return getNumPresets() - 1;
+}
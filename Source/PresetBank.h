@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+
+    The plugin's programs: a few factory scenes built from parameterSpecs,
+    followed by whatever user presets sit in the preset folder. A preset is
+    a plain value per parameter, so it can be turned into ChainSettings off
+    the audio thread and handed over in one piece.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "ParameterIds.h"
+
+struct Preset
+{
+    juce::String name;
+
+    // plain (not normalised) values, indexed by ParameterId
+    std::array<float, numParameters> values{};
+
+    static Preset withDefaults(const juce::String& name);
+
+    float get(ParameterId parameter) const noexcept { return values[static_cast<size_t>(parameter)]; }
+    void set(ParameterId parameter, float value) noexcept;
+
+    std::unique_ptr<juce::XmlElement> toXml() const;
+
+    // parameters missing from the file keep their defaults, unknown ones are skipped
+    static Preset fromXml(const juce::XmlElement& xml);
+};
+
+//==============================================================================
+class PresetBank
+{
+public:
+    PresetBank();
+
+    int getNumPresets() const noexcept { return (int)presets.size(); }
+    int getNumFactoryPresets() const noexcept { return numFactoryPresets; }
+
+    const Preset& getPreset(int index) const;
+    void renamePreset(int index, const juce::String& newName);
+
+    /** Message thread. Replaces the user presets with the files found in
+        directory; the factory presets always stay in front.
+    */
+    void loadUserPresets(const juce::File& directory = getDefaultUserDirectory());
+
+    /** Writes the preset to directory and adds it to the bank, replacing a
+        user preset with the same name. Returns its index, or -1 if the file
+        couldn't be written.
+    */
+    int saveUserPreset(const Preset& preset, const juce::File& directory = getDefaultUserDirectory());
+
+    static juce::File getDefaultUserDirectory();
+
+private:
+    std::vector<Preset> presets;
+    int numFactoryPresets = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetBank)
+};
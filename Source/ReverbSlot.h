@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    ReverbSlot.h
+
+    One reverb position in the chain. All algorithms are prepared up front
+    so switching between them never allocates; only the selected one runs.
+    The algorithms are stereo; on wider buses a SurroundFold runs the
+    selected one once for all channels. Switching algorithms crossfades from
+    the old engine to the new one, so a preset change never clicks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FreeverbCore.h"
+#include "FdnReverb.h"
+#include "ConvolutionReverb.h"
+#include "SurroundFold.h"
+
+enum class ReverbAlgorithm
+{
+    classic,    // FreeverbCore
+    hall,       // FdnReverb
+    convolution // ConvolutionReverb
+};
+
+class ReverbSlot
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    // only the engines that are running take the new parameters, setAlgorithm brings the next one up to date
+    void setParameters(const Parameters& newParams)
+    {
+        parameters = newParams;
+        fold.setDryLevel(newParams.dryLevel);
+
+        setEngineParameters(algorithm);
+
+        if (fadeRemaining > 0)
+            setEngineParameters(fadingAlgorithm);
+    }
+
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    // what the slot does to its input while the wet level is 0, every engine and the
+    // fold scale the dry level the way juce::Reverb does
+    float getDryGain() const noexcept { return parameters.dryLevel * 2.0f; }
+
+    // message thread, before prepare: tells the fold which channel sits where
+    void setChannelLayout(const juce::AudioChannelSet& newLayout) { layout = newLayout; }
+
+    void setAlgorithm(ReverbAlgorithm newAlgorithm) noexcept
+    {
+        if (newAlgorithm == algorithm)
+            return;
+
+        // the incoming engine may hold a stale tail from the last time it ran
+        resetEngine(newAlgorithm);
+        setEngineParameters(newAlgorithm);
+
+        // the outgoing one keeps running until the fade is over
+        fadingAlgorithm = algorithm;
+        fadeRemaining = fadeLength;
+        algorithm = newAlgorithm;
+    }
+
+    ReverbAlgorithm getAlgorithm() const noexcept { return algorithm; }
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        fold.prepare(spec, layout);
+
+        // the engines' dry level depends on whether the fold is active, and has to be
+        // in place before they prepare so their smoothers start there instead of ramping
+        for (auto engine : { ReverbAlgorithm::classic, ReverbAlgorithm::hall, ReverbAlgorithm::convolution })
+            setEngineParameters(engine);
+
+        auto engineSpec = spec;
+        engineSpec.numChannels = juce::jmin(spec.numChannels, (juce::uint32)2);
+
+        classic.prepare(engineSpec);
+        hall.prepare(engineSpec);
+        convolution.prepare(engineSpec);
+
+        fadeBuffer.setSize((int)engineSpec.numChannels, (int)spec.maximumBlockSize);
+        fadeLength = juce::jmax(1, juce::roundToInt(crossfadeSeconds * spec.sampleRate));
+        fadeRemaining = 0;
+    }
+
+    // only the selected engine is cleared, setAlgorithm clears the others when they come back in
+    void reset() noexcept
+    {
+        resetEngine(algorithm);
+        fold.reset();
+        fadeRemaining = 0;
+    }
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        if (fold.isActive())
+        {
+            auto& outputBlock = context.getOutputBlock();
+
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(context.getInputBlock());
+
+            if (! context.isBypassed)
+                fold.process(outputBlock, [this](const auto& stereoContext) { processEngine(stereoContext); });
+
+            return;
+        }
+
+        processEngine(context);
+    }
+
+    size_t getMemoryFootprintBytes() const noexcept
+    {
+        return classic.getMemoryFootprintBytes() + hall.getMemoryFootprintBytes()
+             + convolution.getMemoryFootprintBytes() + fold.getMemoryFootprintBytes()
+             + (size_t)fadeBuffer.getNumChannels() * (size_t)fadeBuffer.getNumSamples() * sizeof(float);
+    }
+
+    // tail of the selected algorithm with the current parameters
+    double getTailSeconds() const noexcept
+    {
+        switch (algorithm)
+        {
+            case ReverbAlgorithm::hall:        return FdnReverb::getTailSeconds(getParameters());
+            case ReverbAlgorithm::convolution: return convolution.getTailSeconds();
+            case ReverbAlgorithm::classic:
+            default:                           return FreeverbCore::getTailSeconds(getParameters());
+        }
+    }
+
+    FreeverbCore classic;
+    FdnReverb hall;
+    ConvolutionReverb convolution;
+
+private:
+    static constexpr double crossfadeSeconds = 0.05;
+
+    void setEngineParameters(ReverbAlgorithm engine) noexcept
+    {
+        const auto engineParameters = fold.isActive() ? SurroundFold::getEngineParameters(parameters) : parameters;
+
+        if (engine == ReverbAlgorithm::hall)
+            hall.setParameters(engineParameters);
+        else if (engine == ReverbAlgorithm::convolution)
+            convolution.setParameters(engineParameters);
+        else
+            classic.setParameters(engineParameters);
+    }
+
+    void resetEngine(ReverbAlgorithm engine) noexcept
+    {
+        if (engine == ReverbAlgorithm::hall)
+            hall.reset();
+        else if (engine == ReverbAlgorithm::convolution)
+            convolution.reset();
+        else
+            classic.reset();
+    }
+
+    template <typename ProcessContext>
+    void processEngine(const ProcessContext& context) noexcept
+    {
+        if (fadeRemaining > 0)
+            processCrossfade(context);
+        else
+            processAlgorithm(algorithm, context);
+    }
+
+    template <typename ProcessContext>
+    void processAlgorithm(ReverbAlgorithm algorithmToRun, const ProcessContext& context) noexcept
+    {
+        if (algorithmToRun == ReverbAlgorithm::hall)
+            hall.process(context);
+        else if (algorithmToRun == ReverbAlgorithm::convolution)
+            convolution.process(context);
+        else
+            classic.process(context);
+    }
+
+    // both engines see the same input, the old one's output fades out linearly under the new one's
+    template <typename ProcessContext>
+    void processCrossfade(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numChannels = outputBlock.getNumChannels();
+        const auto numSamples = (int)outputBlock.getNumSamples();
+
+        jassert(numSamples <= fadeBuffer.getNumSamples() && (int)numChannels <= fadeBuffer.getNumChannels());
+
+        auto fadeBlock = juce::dsp::AudioBlock<float>(fadeBuffer).getSubsetChannelBlock(0, numChannels)
+                                                                 .getSubBlock(0, (size_t)numSamples);
+        fadeBlock.copyFrom(inputBlock);
+
+        processAlgorithm(fadingAlgorithm, juce::dsp::ProcessContextReplacing<float>(fadeBlock));
+        processAlgorithm(algorithm, context);
+
+        const auto step = 1.0f / (float)fadeLength;
+        const auto startGain = (float)(fadeLength - fadeRemaining) * step;
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            auto* output = outputBlock.getChannelPointer(ch);
+            const auto* fading = fadeBlock.getChannelPointer(ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto gain = juce::jmin(1.0f, startGain + (float)i * step);
+                output[i] = fading[i] + gain * (output[i] - fading[i]);
+            }
+        }
+
+        fadeRemaining = juce::jmax(0, fadeRemaining - numSamples);
+    }
+
+    ReverbAlgorithm algorithm = ReverbAlgorithm::classic;
+    ReverbAlgorithm fadingAlgorithm = ReverbAlgorithm::classic;
+    int fadeLength = 1, fadeRemaining = 0;
+    juce::AudioBuffer<float> fadeBuffer;
+
+    Parameters parameters;
+
+    SurroundFold fold;
+    juce::AudioChannelSet layout;
+};
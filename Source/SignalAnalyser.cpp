@@ -0,0 +1,241 @@
+/*
+  ==============================================================================
+
+    SignalAnalyser.cpp
+
+  ==============================================================================
+*/
+
+#include "SignalAnalyser.h"
+
+namespace
+{
+    // how far a spectrum point may fall per frame, so the plot doesn't flicker
+    constexpr float spectrumFallDb = 1.5f;
+
+    // a step this much louder than the one before starts a new decay
+    constexpr float onsetJumpDb = 6.0f;
+
+    // the decay is fitted between 5 and 25 dB below its peak (T20) and extrapolated to 60 dB
+    constexpr float fitStartDb = 5.0f, fitEndDb = 25.0f;
+    constexpr float minimumPeakDb = -60.0f;
+    constexpr int minimumFitSteps = 5;
+
+    constexpr float minimumRt60Seconds = 0.05f, maximumRt60Seconds = 30.0f;
+}
+
+SignalAnalyser::SignalAnalyser()
+    : juce::Thread("Mars analysis")
+{
+    chunk.setSize(AnalysisFifo::numChannels, 1024);
+
+    spectrum.fill(floorDb);
+    rmsHistory.fill(floorDb);
+    peakHistory.fill(floorDb);
+    decayHistory.fill(floorDb);
+    workingDecay.fill(floorDb);
+}
+
+SignalAnalyser::~SignalAnalyser()
+{
+    stop();
+}
+
+void SignalAnalyser::start()
+{
+    if (isThreadRunning())
+        return;
+
+    // nobody reads while the thread is down, so whatever piled up before is stale
+    fifo.discard();
+
+    startThread();
+    active.store(true, std::memory_order_release);
+}
+
+void SignalAnalyser::stop()
+{
+    active.store(false, std::memory_order_release);
+    stopThread(1000);
+}
+
+//==============================================================================
+void SignalAnalyser::copySpectrum(std::array<float, numSpectrumPoints>& destination) const
+{
+    const juce::ScopedLock sl(resultsLock);
+    destination = spectrum;
+}
+
+void SignalAnalyser::copyLevels(std::array<float, levelHistorySize>& rms, std::array<float, levelHistorySize>& peak) const
+{
+    const juce::ScopedLock sl(resultsLock);
+    rms = rmsHistory;
+    peak = peakHistory;
+}
+
+void SignalAnalyser::copyDecay(std::array<float, decayHistorySize>& destination) const
+{
+    const juce::ScopedLock sl(resultsLock);
+    destination = decayHistory;
+}
+
+//==============================================================================
+void SignalAnalyser::run()
+{
+    while (! threadShouldExit())
+    {
+        wait(1000 / frameRateHz);
+        analyseNewSamples();
+    }
+}
+
+void SignalAnalyser::analyseNewSamples()
+{
+    decayStepSamples = juce::jmax(1, juce::roundToInt(sampleRate.load() * decayStepSeconds));
+
+    auto gotSamples = false;
+
+    while (const auto numSamples = fifo.pop(chunk))
+    {
+        const auto* left = chunk.getReadPointer(0);
+        const auto* right = chunk.getReadPointer(1);
+
+        for (int i = 0; i < numSamples; ++i)
+            addSample(left[i], right[i]);
+
+        gotSamples = true;
+    }
+
+    // the host stopped calling processBlock, the last frame stays up
+    if (! gotSamples)
+        return;
+
+    updateSpectrum();
+
+    const auto rmsDb = juce::Decibels::gainToDecibels((float)std::sqrt(frameSumSquares / juce::jmax(1, frameSamples)), floorDb);
+    const auto peakDb = juce::Decibels::gainToDecibels(framePeak, floorDb);
+
+    frameSumSquares = 0.0;
+    framePeak = 0.0f;
+    frameSamples = 0;
+
+    {
+        const juce::ScopedLock sl(resultsLock);
+
+        std::rotate(rmsHistory.begin(), rmsHistory.begin() + 1, rmsHistory.end());
+        std::rotate(peakHistory.begin(), peakHistory.begin() + 1, peakHistory.end());
+        rmsHistory.back() = rmsDb;
+        peakHistory.back() = peakDb;
+
+        decayHistory = workingDecay;
+    }
+
+    latestRmsDb.store(rmsDb);
+    latestPeakDb.store(peakDb);
+    frameCount.fetch_add(1, std::memory_order_release);
+}
+
+void SignalAnalyser::addSample(float left, float right) noexcept
+{
+    recent[(size_t)recentPosition] = 0.5f * (left + right);
+    recentPosition = (recentPosition + 1) & (fftSize - 1);
+
+    const auto energy = 0.5 * ((double)left * left + (double)right * right);
+
+    frameSumSquares += energy;
+    framePeak = juce::jmax(framePeak, std::abs(left), std::abs(right));
+    ++frameSamples;
+
+    decaySumSquares += energy;
+
+    if (++decaySamples >= decayStepSamples)
+    {
+        addDecayStep(juce::Decibels::gainToDecibels((float)std::sqrt(decaySumSquares / decaySamples), floorDb));
+        decaySumSquares = 0.0;
+        decaySamples = 0;
+    }
+}
+
+void SignalAnalyser::updateSpectrum()
+{
+    // the latest fftSize samples, oldest first
+    for (int i = 0; i < fftSize; ++i)
+        fftData[(size_t)i] = recent[(size_t)((recentPosition + i) & (fftSize - 1))];
+
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.0f);
+
+    window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    // a full scale sine reads 0 dB: Hann halves the amplitude and a real FFT splits it over two bins
+    const auto scale = 4.0f / (float)fftSize;
+    const auto binsPerHz = (float)(fftSize / sampleRate.load());
+
+    std::array<float, numSpectrumPoints> frame;
+
+    for (int point = 0; point < numSpectrumPoints; ++point)
+    {
+        const auto frequency = lowestFrequency * std::pow(highestFrequency / lowestFrequency, (float)point / (float)(numSpectrumPoints - 1));
+        const auto bin = juce::jlimit(0.0f, (float)(fftSize / 2 - 1), frequency * binsPerHz);
+        const auto index = (int)bin;
+        const auto fraction = bin - (float)index;
+        const auto magnitude = fftData[(size_t)index] + fraction * (fftData[(size_t)index + 1] - fftData[(size_t)index]);
+
+        // only this thread writes spectrum, so reading the last frame needs no lock
+        frame[(size_t)point] = juce::jmax(juce::Decibels::gainToDecibels(magnitude * scale, floorDb),
+                                          spectrum[(size_t)point] - spectrumFallDb);
+    }
+
+    const juce::ScopedLock sl(resultsLock);
+    spectrum = frame;
+}
+
+void SignalAnalyser::addDecayStep(float levelDb) noexcept
+{
+    std::rotate(workingDecay.begin(), workingDecay.begin() + 1, workingDecay.end());
+    workingDecay.back() = levelDb;
+
+    auto clearFit = [this] { fitCount = fitSumT = fitSumD = fitSumTT = fitSumTD = 0.0; };
+
+    if (levelDb > decayPeakDb || levelDb > lastDecayDb + onsetJumpDb)
+    {
+        decayPeakDb = levelDb;
+        stepsSincePeak = 0;
+        clearFit();
+    }
+    else
+    {
+        const auto t = ++stepsSincePeak * decayStepSeconds;
+        const auto fall = decayPeakDb - levelDb;
+
+        if (decayPeakDb > minimumPeakDb && fall >= fitStartDb && fall <= fitEndDb)
+        {
+            fitCount += 1.0;
+            fitSumT += t;
+            fitSumD += levelDb;
+            fitSumTT += t * t;
+            fitSumTD += t * levelDb;
+        }
+
+        if (fall > fitEndDb)
+        {
+            const auto denominator = fitCount * fitSumTT - fitSumT * fitSumT;
+
+            if (fitCount >= minimumFitSteps && denominator > 0.0)
+            {
+                // dB per second, least squares over the T20 range
+                const auto slope = (fitCount * fitSumTD - fitSumT * fitSumD) / denominator;
+
+                if (slope < 0.0)
+                    rt60Seconds.store(juce::jlimit(minimumRt60Seconds, maximumRt60Seconds, (float)(-60.0 / slope)));
+            }
+
+            // whatever is left of this decay is measured from here
+            decayPeakDb = levelDb;
+            stepsSincePeak = 0;
+            clearFit();
+        }
+    }
+
+    lastDecayDb = levelDb;
+}
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    SignalAnalyser.h
+
+    Output analysis for the GUI, done on a thread of its own at a capped
+    frame rate: a log-frequency spectrum, RMS and peak levels, and an RT60
+    estimate taken from how fast the level falls after the input stops.
+    processBlock only hands the output to an AnalysisFifo, and only while
+    the thread runs, which the processor ties to an editor being open.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "AnalysisFifo.h"
+
+class SignalAnalyser  : private juce::Thread
+{
+public:
+    static constexpr int frameRateHz = 30;
+
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numSpectrumPoints = 256;
+    static constexpr float lowestFrequency = 20.0f, highestFrequency = 20000.0f;
+
+    static constexpr int levelHistorySize = 128;
+
+    // the level envelope the RT60 is fitted to, in steps of decayStepSeconds
+    static constexpr int decayHistorySize = 400;
+    static constexpr double decayStepSeconds = 0.01;
+
+    // what the plots show as silence
+    static constexpr float floorDb = -90.0f;
+
+    SignalAnalyser();
+    ~SignalAnalyser() override;
+
+    void setSampleRate(double newSampleRate) noexcept { sampleRate.store(newSampleRate); }
+
+    // message thread; the audio thread only pushes while the analysis runs
+    void start();
+    void stop();
+
+    bool isActive() const noexcept { return active.load(std::memory_order_acquire); }
+
+    // audio thread: one copy into the FIFO, or nothing at all while stopped
+    void pushSamples(const juce::AudioBuffer<float>& buffer) noexcept
+    {
+        if (isActive())
+            fifo.push(buffer);
+    }
+
+    //==============================================================================
+    // message thread, each one copies the latest frame
+
+    // bumped every analysed frame, so a plot can tell whether there is anything new
+    juce::uint32 getFrameCount() const noexcept { return frameCount.load(std::memory_order_acquire); }
+
+    // dB per point, log spaced from lowestFrequency to highestFrequency
+    void copySpectrum(std::array<float, numSpectrumPoints>& destination) const;
+
+    // dB per frame, oldest first
+    void copyLevels(std::array<float, levelHistorySize>& rms, std::array<float, levelHistorySize>& peak) const;
+
+    // dB per decay step, oldest first
+    void copyDecay(std::array<float, decayHistorySize>& destination) const;
+
+    float getRmsDb() const noexcept { return latestRmsDb.load(); }
+    float getPeakDb() const noexcept { return latestPeakDb.load(); }
+
+    // 0 until a decay long enough to measure has been seen
+    float getRt60Seconds() const noexcept { return rt60Seconds.load(); }
+
+private:
+    void run() override;
+    void analyseNewSamples();
+    void addSample(float left, float right) noexcept;
+    void updateSpectrum();
+    void addDecayStep(float levelDb) noexcept;
+
+    AnalysisFifo fifo;
+    std::atomic<bool> active{ false };
+    std::atomic<double> sampleRate{ 44100.0 };
+
+    //==============================================================================
+    // analysis thread only
+    juce::AudioBuffer<float> chunk;
+
+    juce::dsp::FFT fft{ fftOrder };
+    juce::dsp::WindowingFunction<float> window{ (size_t)fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+    std::array<float, fftSize> recent{};
+    std::array<float, fftSize * 2> fftData{};
+    int recentPosition = 0;
+
+    double frameSumSquares = 0.0;
+    float framePeak = 0.0f;
+    int frameSamples = 0;
+
+    double decaySumSquares = 0.0;
+    int decaySamples = 0, decayStepSamples = 441;
+    std::array<float, decayHistorySize> workingDecay{};
+
+    // the loudest step since the last onset, and the T20 fit over the fall after it
+    float decayPeakDb = floorDb, lastDecayDb = floorDb;
+    int stepsSincePeak = 0;
+    double fitCount = 0.0, fitSumT = 0.0, fitSumD = 0.0, fitSumTT = 0.0, fitSumTD = 0.0;
+
+    //==============================================================================
+    // written by the analysis thread, copied out by the message thread
+    juce::CriticalSection resultsLock;
+    std::array<float, numSpectrumPoints> spectrum{};
+    std::array<float, levelHistorySize> rmsHistory{}, peakHistory{};
+    std::array<float, decayHistorySize> decayHistory{};
+
+    std::atomic<juce::uint32> frameCount{ 0 };
+    std::atomic<float> latestRmsDb{ floorDb }, latestPeakDb{ floorDb }, rt60Seconds{ 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SignalAnalyser)
+};
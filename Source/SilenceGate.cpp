@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    SilenceGate.cpp
+
+  ==============================================================================
+*/
+
+#include "SilenceGate.h"
+
+void SilenceGate::prepare(double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void SilenceGate::reset() noexcept
+{
+    silentInputSamples = quietOutputSamples = 0;
+    inputSilent = idle = false;
+}
+
+void SilenceGate::setTail(double tailSeconds, double longestGapSeconds) noexcept
+{
+    // an infinite tail (freeze) never goes idle
+    tailSamples = std::isfinite(tailSeconds) ? (juce::int64)std::ceil(tailSeconds * sampleRate)
+                                             : std::numeric_limits<juce::int64>::max();
+    gapSamples = (juce::int64)std::ceil(juce::jmin(longestGapSeconds, tailSeconds) * sampleRate);
+}
+
+float SilenceGate::getPeak(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    float peak = 0.0f;
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        peak = juce::jmax(peak, buffer.getMagnitude(ch, 0, buffer.getNumSamples()));
+
+    return peak;
+}
+
+//==============================================================================
+bool SilenceGate::shouldSkip(const juce::AudioBuffer<float>& input) noexcept
+{
+    inputSilent = getPeak(input) <= threshold;
+
+    if (! inputSilent)
+    {
+        idle = false;
+        silentInputSamples = quietOutputSamples = 0;
+        return false;
+    }
+
+    return idle;
+}
+
+void SilenceGate::blockProcessed(const juce::AudioBuffer<float>& output) noexcept
+{
+    if (! inputSilent || tailSamples == std::numeric_limits<juce::int64>::max())
+        return;
+
+    const auto numSamples = (juce::int64)output.getNumSamples();
+    silentInputSamples += numSamples;
+
+    if (getPeak(output) > threshold)
+    {
+        quietOutputSamples = 0;
+        return;
+    }
+
+    quietOutputSamples += numSamples;
+
+    // either everything has had time to decay, or it's been quiet for longer than any echo can hide
+    if (silentInputSamples >= tailSamples || quietOutputSamples >= gapSamples)
+        idle = true;
+}
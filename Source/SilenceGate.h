@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    SilenceGate.h
+
+    Decides when the chain has nothing left to do. Once the input has been
+    digital silence and the output has stayed below the threshold for
+    longer than any echo can take to come back, the chain is parked and
+    processBlock skips it until input arrives again.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class SilenceGate
+{
+public:
+    // -120 dBFS
+    static constexpr float threshold = 1.0e-6f;
+
+    SilenceGate() = default;
+
+    void prepare(double newSampleRate) noexcept;
+
+    // back to processing, forgets how long things have been quiet
+    void reset() noexcept;
+
+    /** tailSeconds is how long the chain can keep ringing after its input
+        stops, longestGapSeconds the longest it can stay quiet in between,
+        e.g. a delay line still waiting to play its echo.
+    */
+    void setTail(double tailSeconds, double longestGapSeconds) noexcept;
+
+    // audio thread, before processing: true if the chain is parked and this block can be skipped
+    bool shouldSkip(const juce::AudioBuffer<float>& input) noexcept;
+
+    // audio thread, after processing a block that wasn't skipped
+    void blockProcessed(const juce::AudioBuffer<float>& output) noexcept;
+
+    bool isIdle() const noexcept { return idle; }
+
+private:
+    static float getPeak(const juce::AudioBuffer<float>& buffer) noexcept;
+
+    double sampleRate = 44100.0;
+    juce::int64 tailSamples = 0, gapSamples = 0;
+    juce::int64 silentInputSamples = 0, quietOutputSamples = 0;
+    bool inputSilent = false, idle = false;
+};
@@ -0,0 +1,28 @@
+/*
+  ==============================================================================
+
+    StageBypass.cpp
+
+  ==============================================================================
+*/
+
+#include "StageBypass.h"
+
+void StageBypass::prepare(double sampleRate) noexcept
+{
+    fadeLength = juce::jmax(1, juce::roundToInt(sampleRate * fadeSeconds));
+    fadeRemaining = 0;
+}
+
+bool StageBypass::setActive(bool shouldBeActive) noexcept
+{
+    if (shouldBeActive == active)
+        return false;
+
+    const auto wasElided = isElided();
+
+    active = shouldBeActive;
+    fadeRemaining = fadeLength - fadeRemaining;
+
+    return shouldBeActive && wasElided;
+}
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    StageBypass.h
+
+    Takes a chain stage out of the signal path while it has nothing to
+    contribute and puts it back once it has, crossfading either way so
+    neither switch clicks. While it is out the stage reduces to a plain
+    gain (1 for a chorus or filter, the dry gain for a reverb) and isn't
+    run at all. A stage coming back starts from a reset, so whatever it
+    still held from before never plays.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class StageBypass
+{
+public:
+    static constexpr double fadeSeconds = 0.02;
+
+    StageBypass() = default;
+
+    void prepare(double sampleRate) noexcept;
+
+    // finishes any fade, the stage is then fully in or fully out
+    void reset() noexcept { fadeRemaining = 0; }
+
+    /** Returns true if the stage was fully out and has to be reset before it
+        runs again. Changing direction halfway through a fade turns it around
+        from where it is.
+    */
+    bool setActive(bool shouldBeActive) noexcept;
+
+    bool isActive() const noexcept { return active; }
+    bool isFading() const noexcept { return fadeRemaining > 0; }
+
+    // fully out: process() only applies the gain
+    bool isElided() const noexcept { return ! active && fadeRemaining == 0; }
+
+    /** Runs processStage on block in place, or applies bypassGain instead.
+        While fading both happen, the bypassed copy going into scratch, which
+        needs as many channels and samples as block.
+    */
+    template <typename ProcessFunction>
+    void process(juce::dsp::AudioBlock<float>& block, juce::AudioBuffer<float>& scratch,
+                 float bypassGain, ProcessFunction&& processStage) noexcept
+    {
+        if (fadeRemaining == 0)
+        {
+            if (active)
+                processStage(block);
+            else if (bypassGain != 1.0f)
+                block.multiplyBy(bypassGain);
+
+            return;
+        }
+
+        const auto numChannels = block.getNumChannels();
+        const auto numSamples = (int)block.getNumSamples();
+
+        jassert((int)numChannels <= scratch.getNumChannels() && numSamples <= scratch.getNumSamples());
+
+        auto bypassed = juce::dsp::AudioBlock<float>(scratch).getSubsetChannelBlock(0, numChannels)
+                                                             .getSubBlock(0, (size_t)numSamples);
+        bypassed.copyFrom(block).multiplyBy(bypassGain);
+
+        processStage(block);
+
+        // share of the processed signal, rising while the stage comes in and falling while it goes
+        const auto step = (active ? 1.0f : -1.0f) / (float)fadeLength;
+        const auto start = active ? 1.0f - (float)fadeRemaining / (float)fadeLength
+                                  : (float)fadeRemaining / (float)fadeLength;
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            auto* output = block.getChannelPointer(ch);
+            const auto* bypass = bypassed.getChannelPointer(ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto gain = juce::jlimit(0.0f, 1.0f, start + (float)i * step);
+                output[i] = bypass[i] + gain * (output[i] - bypass[i]);
+            }
+        }
+
+        fadeRemaining = juce::jmax(0, fadeRemaining - numSamples);
+    }
+
+private:
+    bool active = true;
+    int fadeLength = 1, fadeRemaining = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StageBypass)
+};
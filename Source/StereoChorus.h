@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    StereoChorus.h
+
+    Two chorus voices, one per side, so a stereo chain can keep the slightly
+    detuned left/right modulation and feedback the sound relies on while the
+    rest of the chain processes both channels in one go. On wider buses the
+    channels after the first two share two more multichannel voices, even
+    ones following the left side and odd ones the right. The LFOs come from
+    the chain's LfoBank, one per side however many channels there are.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "ChorusVoice.h"
+
+struct StereoChorus
+{
+    ChorusVoice left, right, surroundLeft, surroundRight;
+    int numSurroundLeft = 0, numSurroundRight = 0;
+
+    static constexpr int maximumSurroundPerSide = ChorusVoice::maximumChannels;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        auto monoSpec = spec;
+        monoSpec.numChannels = 1;
+
+        left.prepare(monoSpec);
+        right.prepare(monoSpec);
+
+        const auto numSurround = juce::jmax(0, (int)spec.numChannels - 2);
+        numSurroundLeft = juce::jmin((numSurround + 1) / 2, maximumSurroundPerSide);
+        numSurroundRight = juce::jmin(numSurround / 2, maximumSurroundPerSide);
+
+        auto surroundSpec = spec;
+
+        if (numSurroundLeft > 0)
+        {
+            surroundSpec.numChannels = (juce::uint32)numSurroundLeft;
+            surroundLeft.prepare(surroundSpec);
+        }
+
+        if (numSurroundRight > 0)
+        {
+            surroundSpec.numChannels = (juce::uint32)numSurroundRight;
+            surroundRight.prepare(surroundSpec);
+        }
+    }
+
+    void reset() noexcept
+    {
+        left.reset();
+        right.reset();
+
+        if (numSurroundLeft > 0)
+            surroundLeft.reset();
+
+        if (numSurroundRight > 0)
+            surroundRight.reset();
+    }
+
+    void setFeedback(float leftFeedback, float rightFeedback)
+    {
+        left.setFeedback(leftFeedback);
+        right.setFeedback(rightFeedback);
+        surroundLeft.setFeedback(leftFeedback);
+        surroundRight.setFeedback(rightFeedback);
+    }
+
+    void setMix(float newMix)
+    {
+        left.setMix(newMix);
+        right.setMix(newMix);
+        surroundLeft.setMix(newMix);
+        surroundRight.setMix(newMix);
+    }
+
+    void setDepth(float newDepth)
+    {
+        left.setDepth(newDepth);
+        right.setDepth(newDepth);
+        surroundLeft.setDepth(newDepth);
+        surroundRight.setDepth(newDepth);
+    }
+
+    // in place, the LFOs hold a value for each sample of block
+    void process(const juce::dsp::AudioBlock<float>& block, const float* leftLfo, const float* rightLfo) noexcept
+    {
+        processChannel(block, 0, leftLfo);
+
+        if (block.getNumChannels() > 1)
+            processChannel(block, 1, rightLfo);
+
+        if (block.getNumChannels() > 2)
+            processSurround(block, leftLfo, rightLfo);
+    }
+
+    // one side only, in place; the two sides share nothing so they can run on different threads
+    void processChannel(const juce::dsp::AudioBlock<float>& block, size_t channel, const float* lfo) noexcept
+    {
+        (channel == 0 ? left : right).process(block.getSingleChannelBlock(channel), lfo);
+    }
+
+    // every channel after the first two, in place
+    void processSurround(const juce::dsp::AudioBlock<float>& block, const float* leftLfo, const float* rightLfo) noexcept
+    {
+        const auto numChannels = (int)block.getNumChannels();
+
+        for (int side = 0; side < 2; ++side)
+        {
+            std::array<float*, maximumSurroundPerSide> channels{};
+            const auto numSideChannels = side == 0 ? numSurroundLeft : numSurroundRight;
+            int count = 0;
+
+            for (int channel = 2 + side; channel < numChannels && count < numSideChannels; channel += 2)
+                channels[(size_t)count++] = block.getChannelPointer((size_t)channel);
+
+            if (count == 0)
+                continue;
+
+            juce::dsp::AudioBlock<float> sideBlock(channels.data(), (size_t)count, block.getNumSamples());
+            (side == 0 ? surroundLeft : surroundRight).process(sideBlock, side == 0 ? leftLfo : rightLfo);
+        }
+    }
+};
+
+//==============================================================================
+/** One StereoChorus per oversampling factor (1x, 2x, 4x), each prepared at its
+    own rate and all fed the same settings. Changing the factor while playing
+    then only switches voices instead of reallocating delay lines.
+*/
+struct MultiRateChorus
+{
+    static constexpr int numRates = 3;
+
+    std::array<StereoChorus, numRates> voices;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        for (int i = 0; i < numRates; ++i)
+        {
+            auto rateSpec = spec;
+            rateSpec.sampleRate = spec.sampleRate * (double)(1 << i);
+            rateSpec.maximumBlockSize = spec.maximumBlockSize << i;
+            voices[(size_t)i].prepare(rateSpec);
+        }
+    }
+
+    void reset() noexcept
+    {
+        for (auto& voice : voices)
+            voice.reset();
+    }
+
+    // 0 = 1x, 1 = 2x, 2 = 4x
+    void setRateIndex(int newIndex) noexcept
+    {
+        newIndex = juce::jlimit(0, numRates - 1, newIndex);
+
+        if (newIndex != rateIndex)
+        {
+            voices[(size_t)newIndex].reset();
+            rateIndex = newIndex;
+        }
+    }
+
+    int getRateIndex() const noexcept { return rateIndex; }
+
+    void setFeedback(float leftFeedback, float rightFeedback)
+    {
+        for (auto& voice : voices)
+            voice.setFeedback(leftFeedback, rightFeedback);
+    }
+
+    void setMix(float newMix)
+    {
+        for (auto& voice : voices)
+            voice.setMix(newMix);
+    }
+
+    void setDepth(float newDepth)
+    {
+        for (auto& voice : voices)
+            voice.setDepth(newDepth);
+    }
+
+    void process(const juce::dsp::AudioBlock<float>& block, const float* leftLfo, const float* rightLfo) noexcept
+    {
+        voices[(size_t)rateIndex].process(block, leftLfo, rightLfo);
+    }
+
+    void processChannel(const juce::dsp::AudioBlock<float>& block, size_t channel, const float* lfo) noexcept
+    {
+        voices[(size_t)rateIndex].processChannel(block, channel, lfo);
+    }
+
+private:
+    int rateIndex = 0;
+};
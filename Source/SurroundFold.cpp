@@ -0,0 +1,244 @@
+/*
+  ==============================================================================
+
+    SurroundFold.cpp
+
+  ==============================================================================
+*/
+
+#include "SurroundFold.h"
+
+namespace
+{
+    enum class Side { left, right, centre, none };
+
+    Side getSide(juce::AudioChannelSet::ChannelType type, int index) noexcept
+    {
+        using Set = juce::AudioChannelSet;
+
+        switch (type)
+        {
+            case Set::left:
+            case Set::leftSurround:
+            case Set::leftCentre:
+            case Set::leftSurroundSide:
+            case Set::leftSurroundRear:
+            case Set::wideLeft:
+            case Set::topFrontLeft:
+            case Set::topRearLeft:
+            case Set::topSideLeft:
+                return Side::left;
+
+            case Set::right:
+            case Set::rightSurround:
+            case Set::rightCentre:
+            case Set::rightSurroundSide:
+            case Set::rightSurroundRear:
+            case Set::wideRight:
+            case Set::topFrontRight:
+            case Set::topRearRight:
+            case Set::topSideRight:
+                return Side::right;
+
+            case Set::centre:
+            case Set::centreSurround:
+            case Set::topMiddle:
+            case Set::topFrontCentre:
+            case Set::topRearCentre:
+                return Side::centre;
+
+            case Set::LFE:
+            case Set::LFE2:
+                return Side::none;
+
+            default:
+                // ambisonic and discrete channels have no side
+                return index % 2 == 0 ? Side::left : Side::right;
+        }
+    }
+
+    // two mutually prime allpass lengths per decorrelated channel, in ms
+    constexpr float allpassTimes[SurroundFold::maximumChannels][2] = {
+        { 2.3f, 5.9f },  { 2.9f, 6.7f },  { 3.1f, 7.3f },  { 3.7f, 7.9f },
+        { 4.1f, 8.3f },  { 4.3f, 8.9f },  { 4.7f, 9.7f },  { 5.3f, 10.1f },
+        { 5.9f, 10.3f }, { 6.1f, 10.7f }, { 6.7f, 11.3f }, { 7.1f, 11.9f },
+        { 7.3f, 12.7f }, { 7.9f, 13.1f }, { 8.3f, 13.7f }, { 8.9f, 14.9f }
+    };
+}
+
+//==============================================================================
+void SurroundFold::prepare(const juce::dsp::ProcessSpec& spec, const juce::AudioChannelSet& layout)
+{
+    numChannels = juce::jmin((int)spec.numChannels, maximumChannels);
+    jassert((int)spec.numChannels <= maximumChannels);
+
+    if (! isActive())
+    {
+        stereo.setSize(0, 0);
+        allpassMemory.free();
+        allpassMemorySize = 0;
+        return;
+    }
+
+    const auto channelTypes = layout.size() == numChannels ? layout.getChannelTypes()
+                                                           : juce::AudioChannelSet::discreteChannels(numChannels).getChannelTypes();
+
+    // each side of the engine sees the same power however many channels feed it
+    float leftPower = 0.0f, rightPower = 0.0f;
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        auto& channel = channels[(size_t)i];
+
+        switch (getSide(channelTypes[i], i))
+        {
+            case Side::left:   channel.left = 1.0f;  channel.right = 0.0f;  break;
+            case Side::right:  channel.left = 0.0f;  channel.right = 1.0f;  break;
+            case Side::centre: channel.left = juce::MathConstants<float>::sqrt2 * 0.5f; channel.right = channel.left; break;
+            case Side::none:   channel.left = 0.0f;  channel.right = 0.0f;  break;
+        }
+
+        leftPower += channel.left * channel.left;
+        rightPower += channel.right * channel.right;
+    }
+
+    const auto leftScale = leftPower > 0.0f ? 1.0f / std::sqrt(leftPower) : 0.0f;
+    const auto rightScale = rightPower > 0.0f ? 1.0f / std::sqrt(rightPower) : 0.0f;
+
+    // the first channel on each side takes the engine's output as it is, every other one is decorrelated
+    bool hasPlainLeft = false, hasPlainRight = false;
+    size_t memorySize = 0;
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        auto& channel = channels[(size_t)i];
+        const auto isLeftOnly = channel.left > 0.0f && channel.right == 0.0f;
+        const auto isRightOnly = channel.right > 0.0f && channel.left == 0.0f;
+
+        channel.decorrelate = channel.left > 0.0f || channel.right > 0.0f;
+
+        if (isLeftOnly && ! hasPlainLeft)
+        {
+            hasPlainLeft = true;
+            channel.decorrelate = false;
+        }
+        else if (isRightOnly && ! hasPlainRight)
+        {
+            hasPlainRight = true;
+            channel.decorrelate = false;
+        }
+
+        channel.left *= leftScale;
+        channel.right *= rightScale;
+
+        for (size_t k = 0; k < 2; ++k)
+        {
+            channel.allpasses[k].length = channel.decorrelate
+                                        ? juce::jmax(1, juce::roundToInt(allpassTimes[i][k] * 0.001 * spec.sampleRate))
+                                        : 0;
+            memorySize += (size_t)channel.allpasses[k].length;
+        }
+    }
+
+    allpassMemory.allocate(memorySize, true);
+    allpassMemorySize = memorySize;
+
+    auto* memory = allpassMemory.get();
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        for (auto& allpass : channels[(size_t)i].allpasses)
+        {
+            allpass.buffer = memory;
+            allpass.position = 0;
+            memory += allpass.length;
+        }
+    }
+
+    stereo.setSize(3, (int)spec.maximumBlockSize);
+    dryGain.reset(spec.sampleRate, 0.01);
+}
+
+void SurroundFold::reset() noexcept
+{
+    if (allpassMemory != nullptr)
+        juce::zeromem(allpassMemory.get(), allpassMemorySize * sizeof(float));
+
+    for (auto& channel : channels)
+        for (auto& allpass : channel.allpasses)
+            allpass.position = 0;
+
+    dryGain.setCurrentAndTargetValue(dryGain.getTargetValue());
+}
+
+size_t SurroundFold::getMemoryFootprintBytes() const noexcept
+{
+    return allpassMemorySize * sizeof(float)
+         + (size_t)stereo.getNumChannels() * (size_t)stereo.getNumSamples() * sizeof(float);
+}
+
+//==============================================================================
+void SurroundFold::fold(const juce::dsp::AudioBlock<float>& block, int numSamples) noexcept
+{
+    auto* left = stereo.getWritePointer(0);
+    auto* right = stereo.getWritePointer(1);
+
+    juce::FloatVectorOperations::clear(left, numSamples);
+    juce::FloatVectorOperations::clear(right, numSamples);
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        const auto& channel = channels[(size_t)i];
+        const auto* input = block.getChannelPointer((size_t)i);
+
+        if (channel.left > 0.0f)
+            juce::FloatVectorOperations::addWithMultiply(left, input, channel.left, numSamples);
+
+        if (channel.right > 0.0f)
+            juce::FloatVectorOperations::addWithMultiply(right, input, channel.right, numSamples);
+    }
+}
+
+void SurroundFold::unfold(const juce::dsp::AudioBlock<float>& block, int numSamples) noexcept
+{
+    const auto* wetLeft = stereo.getReadPointer(0);
+    const auto* wetRight = stereo.getReadPointer(1);
+
+    // third row of the scratch buffer: the dry gain ramp, shared by every channel
+    auto* dry = stereo.getWritePointer(2);
+
+    if (dryGain.isSmoothing())
+    {
+        for (int n = 0; n < numSamples; ++n)
+            dry[n] = dryGain.getNextValue();
+    }
+    else
+    {
+        juce::FloatVectorOperations::fill(dry, dryGain.getTargetValue(), numSamples);
+    }
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        auto& channel = channels[(size_t)i];
+        auto* output = block.getChannelPointer((size_t)i);
+
+        juce::FloatVectorOperations::multiply(output, dry, numSamples);
+
+        if (! channel.decorrelate)
+        {
+            if (channel.left > 0.0f)
+                juce::FloatVectorOperations::addWithMultiply(output, wetLeft, channel.left, numSamples);
+
+            if (channel.right > 0.0f)
+                juce::FloatVectorOperations::addWithMultiply(output, wetRight, channel.right, numSamples);
+
+            continue;
+        }
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto wet = wetLeft[n] * channel.left + wetRight[n] * channel.right;
+            output[n] += channel.allpasses[1].process(channel.allpasses[0].process(wet));
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    SurroundFold.h
+
+    Runs a stereo reverb engine on a bus of more than two channels. The
+    channels are folded into the engine's two inputs by the side of the
+    room they sit on, the engine runs once and only makes the wet signal,
+    and every output channel takes its side's wet signal through its own
+    pair of short allpasses, so no two channels carry the same tail. LFE
+    channels stay dry.
+
+    Ambisonic and discrete channels have no side and alternate left and
+    right. Going from stereo to 7.1 adds a handful of multiply-adds per
+    channel instead of another reverb network.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class SurroundFold
+{
+public:
+    static constexpr int maximumChannels = 16;
+
+    /** Message thread. With two channels or fewer the fold stays inactive
+        and the slot runs its engine directly.
+    */
+    void prepare(const juce::dsp::ProcessSpec& spec, const juce::AudioChannelSet& layout);
+    void reset() noexcept;
+
+    bool isActive() const noexcept { return numChannels > 2; }
+
+    // the engine only makes the wet signal while folding, the dry path is applied here
+    static juce::Reverb::Parameters getEngineParameters(juce::Reverb::Parameters params) noexcept
+    {
+        params.dryLevel = 0.0f;
+        return params;
+    }
+
+    void setDryLevel(float dryLevel) noexcept { dryGain.setTargetValue(dryLevel * dryScaleFactor); }
+
+    /** In place on block, which has the channel count given to prepare().
+        processStereo gets a stereo juce::dsp::ProcessContextReplacing.
+    */
+    template <typename ProcessStereo>
+    void process(const juce::dsp::AudioBlock<float>& block, ProcessStereo&& processStereo) noexcept
+    {
+        const auto numSamples = (int)block.getNumSamples();
+        jassert(numSamples <= stereo.getNumSamples());
+
+        fold(block, numSamples);
+
+        auto stereoSubBlock = juce::dsp::AudioBlock<float>(stereo).getSubsetChannelBlock(0, 2)
+                                                                  .getSubBlock(0, (size_t)numSamples);
+        processStereo(juce::dsp::ProcessContextReplacing<float>(stereoSubBlock));
+
+        unfold(block, numSamples);
+    }
+
+    size_t getMemoryFootprintBytes() const noexcept;
+
+private:
+    // same as the algorithms use, so the dry level doesn't jump when the bus widens
+    static constexpr float dryScaleFactor = 2.0f;
+
+    struct Allpass
+    {
+        float* buffer = nullptr;
+        int length = 0, position = 0;
+
+        float process(float input) noexcept
+        {
+            constexpr float gain = 0.5f;
+            const auto delayed = buffer[position];
+            const auto output = delayed - gain * input;
+            buffer[position] = input + gain * output;
+
+            if (++position == length)
+                position = 0;
+
+            return output;
+        }
+    };
+
+    struct Channel
+    {
+        // how much of the channel goes into each engine input, and how much of each wet output comes back
+        float left = 0.0f, right = 0.0f;
+        bool decorrelate = false;
+        std::array<Allpass, 2> allpasses;
+    };
+
+    void fold(const juce::dsp::AudioBlock<float>& block, int numSamples) noexcept;
+    void unfold(const juce::dsp::AudioBlock<float>& block, int numSamples) noexcept;
+
+    int numChannels = 0;
+    std::array<Channel, maximumChannels> channels;
+
+    juce::AudioBuffer<float> stereo;   // the engine's two channels, then the dry gain ramp
+    juce::HeapBlock<float> allpassMemory;
+    size_t allpassMemorySize = 0;
+
+    juce::SmoothedValue<float> dryGain;
+};
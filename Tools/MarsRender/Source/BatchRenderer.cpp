@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+#include "../../../Source/PluginProcessor.h"
+
+BatchRenderer::BatchRenderer(BatchRenderOptions newOptions)
+    : options(std::move(newOptions))
+{
+    options.blockSize = juce::jmax(1, options.blockSize);
+    options.numJobs = juce::jmax(1, options.numJobs);
+}
+
+bool BatchRenderer::applyPreset(juce::AudioProcessorValueTreeState& apvts, const juce::File& preset, juce::String& error)
+{
+    auto xml = juce::parseXML(preset);
+
+    if (xml == nullptr || ! xml->hasTagName(apvts.state.getType()))
+    {
+        error = "not a parameter preset: " + preset.getFullPathName();
+        return false;
+    }
+
+    apvts.replaceState(juce::ValueTree::fromXml(*xml));
+    return true;
+}
+
+//==============================================================================
+BatchRenderResult BatchRenderer::renderFile(const juce::File& input) const
+{
+    BatchRenderResult result;
+    result.input = input;
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+
+    if (reader == nullptr)
+    {
+        result.error = "can't read " + input.getFullPathName();
+        return result;
+    }
+
+    if (reader->numChannels > 2)
+    {
+        result.error = "only mono and stereo files are supported";
+        return result;
+    }
+
+    const auto extension = options.outputExtension.isNotEmpty() ? options.outputExtension : input.getFileExtension();
+    auto* format = formats.findFormatForFileExtension(extension);
+
+    if (format == nullptr)
+    {
+        result.error = "no writer for " + extension;
+        return result;
+    }
+
+    result.output = options.outputDirectory.getChildFile(input.getFileNameWithoutExtension() + extension);
+
+    const auto sampleRate = reader->sampleRate;
+    const auto blockSize = options.blockSize;
+    const int numChannels = 2;
+
+    MarsAudioProcessor processor;
+
+    if (options.preset != juce::File() && ! applyPreset(processor.apvts, options.preset, result.error))
+        return result;
+
+    // picks the render quality tier and lets the chorus use the bounce worker
+    processor.setNonRealtime(true);
+    processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    const auto bitDepths = format->getPossibleBitDepths();
+    const auto bitsPerSample = bitDepths.contains((int)reader->bitsPerSample) ? (int)reader->bitsPerSample : bitDepths.getLast();
+
+    result.output.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream(result.output.createOutputStream());
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (stream != nullptr)
+        writer.reset(format->createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels,
+                                             bitsPerSample, reader->metadataValues, 0));
+
+    if (writer == nullptr)
+    {
+        result.error = "can't write " + result.output.getFullPathName();
+        return result;
+    }
+
+    stream.release(); // the writer owns it now
+
+    // the first latency samples are the oversamplers' delay, they're rendered and dropped
+    const auto latency = (juce::int64)processor.getLatencySamples();
+    const auto tailSeconds = options.tailSeconds < 0.0 ? processor.getTailLengthSeconds() : options.tailSeconds;
+
+    if (! std::isfinite(tailSeconds))
+    {
+        result.error = "the preset rings forever (freeze), give an explicit --tail";
+        return result;
+    }
+
+    const auto outputLength = reader->lengthInSamples + (juce::int64)std::ceil(tailSeconds * sampleRate);
+
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+    juce::MidiBuffer midi;
+
+    for (juce::int64 position = 0; position < outputLength + latency;)
+    {
+        const auto numSamples = (int)juce::jmin((juce::int64)blockSize, outputLength + latency - position);
+        buffer.setSize(numChannels, numSamples, false, false, true);
+
+        // past the end of the file the reader fills in silence
+        reader->read(&buffer, 0, numSamples, position, true, true);
+
+        if (reader->numChannels == 1)
+            buffer.copyFrom(1, 0, buffer, 0, 0, numSamples);
+
+        processor.processBlock(buffer, midi);
+
+        const auto skip = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, latency - position);
+
+        if (skip < numSamples && ! writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip))
+        {
+            result.error = "write failed: " + result.output.getFullPathName();
+            return result;
+        }
+
+        position += numSamples;
+    }
+
+    processor.releaseResources();
+
+    result.numSamples = outputLength;
+    result.seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+    return result;
+}
+
+juce::Array<BatchRenderResult> BatchRenderer::renderFiles(const juce::Array<juce::File>& inputs,
+                                                          std::function<void(const BatchRenderResult&)> onFileDone) const
+{
+    juce::Array<BatchRenderResult> results;
+    results.resize(inputs.size());
+
+    juce::CriticalSection callbackLock;
+    juce::ThreadPool pool(juce::jmin(options.numJobs, juce::jmax(1, inputs.size())));
+
+    for (int i = 0; i < inputs.size(); ++i)
+    {
+        pool.addJob([this, i, &inputs, &results, &onFileDone, &callbackLock]
+        {
+            auto result = renderFile(inputs.getReference(i));
+
+            const juce::ScopedLock sl(callbackLock);
+            results.getReference(i) = result;
+
+            if (onFileDone)
+                onFileDone(result);
+        });
+    }
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep(20);
+
+    return results;
+}
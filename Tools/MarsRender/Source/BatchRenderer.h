@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.h
+
+    Streams audio files through MarsAudioProcessor without a host. Every
+    file gets its own processor instance and is read, processed and written
+    in fixed size chunks, so memory use doesn't depend on the file length.
+    Files are spread over a thread pool.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct BatchRenderOptions
+{
+    juce::File outputDirectory;
+    juce::File preset;               // apvts state XML, parameters keep their defaults if empty
+    juce::String outputExtension;    // ".wav", ".flac"... empty keeps the input's format
+    int blockSize = 4096;
+    int numJobs = 1;
+    double tailSeconds = 0.0;        // extra render time after the input ends, negative for the chain's own tail
+};
+
+struct BatchRenderResult
+{
+    juce::File input, output;
+    juce::String error;              // empty on success
+    juce::int64 numSamples = 0;
+    double seconds = 0.0;            // wall time spent on this file
+
+    bool succeeded() const noexcept { return error.isEmpty(); }
+};
+
+class BatchRenderer
+{
+public:
+    explicit BatchRenderer(BatchRenderOptions options);
+
+    // renders one file on the calling thread
+    BatchRenderResult renderFile(const juce::File& input) const;
+
+    /** Renders all files on options.numJobs threads and returns once every one
+        of them is done. onFileDone is called as each finishes, from the worker
+        that rendered it, never from two threads at once.
+    */
+    juce::Array<BatchRenderResult> renderFiles(const juce::Array<juce::File>& inputs,
+                                              std::function<void(const BatchRenderResult&)> onFileDone = {}) const;
+
+    // loads an apvts state saved as XML into the processor's parameters
+    static bool applyPreset(juce::AudioProcessorValueTreeState& apvts, const juce::File& preset, juce::String& error);
+
+private:
+    BatchRenderOptions options;
+};
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    Benchmark.cpp
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "../../../Source/PluginProcessor.h"
+
+namespace
+{
+    using Stage = MarsAudioProcessor::Stage;
+
+    void applyParameterSet(MarsAudioProcessor& processor, Benchmark::ParameterSet set)
+    {
+        for (const auto& spec : parameterSpecs)
+        {
+            auto* parameter = processor.apvts.getParameter(spec.id);
+            jassert(parameter != nullptr);
+
+            const auto value = set == Benchmark::ParameterSet::minimum ? spec.minValue
+                             : set == Benchmark::ParameterSet::maximum ? spec.maxValue
+                                                                        : spec.defaultValue;
+
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        }
+    }
+
+    void fillWithNoise(juce::AudioBuffer<float>& buffer, juce::Random& random)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample(ch, i, random.nextFloat() * 0.5f - 0.25f);
+    }
+
+    double ticksToSeconds(juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks);
+    }
+}
+
+//==============================================================================
+Benchmark::Benchmark(BenchmarkOptions newOptions)
+    : options(std::move(newOptions))
+{
+}
+
+juce::String Benchmark::getParameterSetName(ParameterSet set)
+{
+    switch (set)
+    {
+        case ParameterSet::minimum: return "minimum";
+        case ParameterSet::maximum: return "maximum";
+        case ParameterSet::defaults: break;
+    }
+
+    return "defaults";
+}
+
+juce::Array<Benchmark::Result> Benchmark::run(std::function<void(const Result&)> onResult) const
+{
+    juce::Array<Result> results;
+
+    auto addResult = [&](Result result)
+    {
+        results.add(result);
+
+        if (onResult)
+            onResult(result);
+    };
+
+    for (auto set : { ParameterSet::defaults, ParameterSet::minimum, ParameterSet::maximum })
+    {
+        for (auto sampleRate : options.sampleRates)
+        {
+            for (auto blockSize : options.blockSizes)
+            {
+                const auto numBlocks = juce::jmax(1, (int)(options.secondsPerMeasurement * sampleRate / blockSize));
+                const auto numSamples = (double)numBlocks * blockSize;
+                const auto audioSeconds = numSamples / sampleRate;
+
+                auto makeResult = [&](juce::String stage, juce::int64 ticks)
+                {
+                    const auto seconds = juce::jmax(1.0e-9, ticksToSeconds(ticks));
+                    return Result{ set, sampleRate, blockSize, stage, seconds * 1.0e9 / numSamples, audioSeconds / seconds };
+                };
+
+                MarsAudioProcessor processor;
+                applyParameterSet(processor, set);
+                processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+                processor.prepareToPlay(sampleRate, blockSize);
+
+                juce::Random random(1);
+                juce::AudioBuffer<float> source(2, blockSize), buffer(2, blockSize);
+                juce::MidiBuffer midi;
+                fillWithNoise(source, random);
+
+                // whole chain, including the parameter snapshot and smoothing processBlock does
+                buffer.makeCopyOf(source, true);
+                processor.processBlock(buffer, midi);
+
+                juce::int64 chainTicks = 0;
+
+                for (int b = 0; b < numBlocks; ++b)
+                {
+                    buffer.makeCopyOf(source, true);
+
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    processor.processBlock(buffer, midi);
+                    chainTicks += juce::Time::getHighResolutionTicks() - start;
+                }
+
+                addResult(makeResult("processBlock", chainTicks));
+
+                for (int s = 0; s < (int)Stage::numStages; ++s)
+                {
+                    const auto stage = (Stage)s;
+                    juce::int64 stageTicks = 0;
+
+                    for (int b = 0; b <= numBlocks; ++b)
+                    {
+                        buffer.makeCopyOf(source, true);
+                        juce::dsp::AudioBlock<float> block(buffer);
+
+                        const auto start = juce::Time::getHighResolutionTicks();
+                        processor.processStage(stage, block);
+
+                        // the first block is warm-up
+                        if (b > 0)
+                            stageTicks += juce::Time::getHighResolutionTicks() - start;
+                    }
+
+                    addResult(makeResult(MarsAudioProcessor::getStageName(stage), stageTicks));
+                }
+
+                processor.releaseResources();
+            }
+        }
+    }
+
+    return results;
+}
+
+juce::var Benchmark::toJSON(const juce::Array<Result>& results)
+{
+    juce::Array<juce::var> entries;
+
+    for (const auto& result : results)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("parameters", getParameterSetName(result.parameterSet));
+        entry->setProperty("sampleRate", result.sampleRate);
+        entry->setProperty("blockSize", result.blockSize);
+        entry->setProperty("stage", result.stage);
+        entry->setProperty("nsPerSample", result.nsPerSample);
+        entry->setProperty("realtimeFactor", result.realtimeFactor);
+        entries.add(juce::var(entry));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+    root->setProperty("results", entries);
+
+    return juce::var(root);
+}
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    Benchmark.h
+
+    Times the full processBlock and every chain stage on its own across
+    buffer sizes, sample rates and the extremes of the parameter ranges,
+    and reports ns per sample and realtime factor as JSON.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct BenchmarkOptions
+{
+    juce::Array<int> blockSizes{ 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    juce::Array<double> sampleRates{ 44100.0, 48000.0, 96000.0, 192000.0 };
+
+    // audio rendered per measurement, after one block of warm-up
+    double secondsPerMeasurement = 1.0;
+};
+
+class Benchmark
+{
+public:
+    // the parameter sets every configuration is measured with
+    enum class ParameterSet
+    {
+        defaults,
+        minimum,
+        maximum
+    };
+
+    struct Result
+    {
+        ParameterSet parameterSet;
+        double sampleRate;
+        int blockSize;
+        juce::String stage;          // "processBlock" for the whole chain
+        double nsPerSample;          // per sample frame, both channels
+        double realtimeFactor;       // seconds of audio per second of CPU, higher is better
+    };
+
+    explicit Benchmark(BenchmarkOptions options);
+
+    /** Runs every measurement, calling onResult after each one. Takes a while
+        with the default sweep, expect a few minutes.
+    */
+    juce::Array<Result> run(std::function<void(const Result&)> onResult = {}) const;
+
+    static juce::String getParameterSetName(ParameterSet set);
+    static juce::var toJSON(const juce::Array<Result>& results);
+
+private:
+    BenchmarkOptions options;
+};
@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    MarsRender, the headless front end to the mars DSP.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "BatchRenderer.h"
+#include "Benchmark.h"
+#include "RegressionCheck.h"
+#include "../../../Source/AllocationCounter.h"
+
+namespace
+{
+    juce::Array<juce::File> getInputFiles(const juce::ArgumentList& args)
+    {
+        juce::Array<juce::File> files;
+
+        for (const auto& arg : args.arguments)
+            if (! arg.isOption())
+                files.add(arg.resolveAsExistingFile());
+
+        return files;
+    }
+
+    int getIntOption(const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        const auto value = args.getValueForOption(option);
+        return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+    }
+
+    void render(const juce::ArgumentList& args)
+    {
+        BatchRenderOptions options;
+        options.outputDirectory = args.containsOption("--out") ? args.getExistingFolderForOption("--out")
+                                                               : juce::File::getCurrentWorkingDirectory();
+
+        if (args.containsOption("--preset"))
+            options.preset = args.getExistingFileForOption("--preset");
+
+        if (args.containsOption("--format"))
+            options.outputExtension = "." + args.getValueForOption("--format").trimCharactersAtStart(".");
+
+        // every processor also runs a bounce worker, so half the cores is one thread per core
+        options.numJobs = getIntOption(args, "--jobs", juce::jmax(1, juce::SystemStats::getNumCpus() / 2));
+        options.blockSize = getIntOption(args, "--block", options.blockSize);
+        options.tailSeconds = args.getValueForOption("--tail") == "auto" ? -1.0
+                                                                         : args.getValueForOption("--tail").getDoubleValue();
+
+        const auto inputs = getInputFiles(args);
+
+        if (inputs.isEmpty())
+            juce::ConsoleApplication::fail("no input files");
+
+        BatchRenderer renderer(options);
+        int numFailed = 0;
+
+        renderer.renderFiles(inputs, [&numFailed](const BatchRenderResult& result)
+        {
+            if (result.succeeded())
+            {
+                std::cout << result.output.getFullPathName() << "  "
+                          << juce::String(result.seconds, 2) << " s" << std::endl;
+            }
+            else
+            {
+                std::cerr << result.input.getFullPathName() << ": " << result.error << std::endl;
+                ++numFailed;
+            }
+        });
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail(juce::String(numFailed) + " of " + juce::String(inputs.size()) + " files failed");
+    }
+
+    void benchmark(const juce::ArgumentList& args)
+    {
+        BenchmarkOptions options;
+
+        if (args.containsOption("--quick"))
+        {
+            options.blockSizes = { 64, 512, 4096 };
+            options.sampleRates = { 48000.0 };
+            options.secondsPerMeasurement = 0.25;
+        }
+
+        if (args.containsOption("--seconds"))
+            options.secondsPerMeasurement = args.getValueForOption("--seconds").getDoubleValue();
+
+        // progress on stderr, so the JSON on stdout can be piped
+        const auto results = Benchmark(options).run([](const Benchmark::Result& result)
+        {
+            std::cerr << Benchmark::getParameterSetName(result.parameterSet) << "  "
+                      << juce::String(result.sampleRate / 1000.0, 1) << " kHz  "
+                      << result.blockSize << "  " << result.stage << "  "
+                      << juce::String(result.nsPerSample, 1) << " ns/sample  x"
+                      << juce::String(result.realtimeFactor, 1) << std::endl;
+        });
+
+        const auto json = juce::JSON::toString(Benchmark::toJSON(results));
+
+        if (args.containsOption("--out"))
+        {
+            const auto file = args.getFileForOption("--out");
+
+            if (! file.replaceWithText(json))
+                juce::ConsoleApplication::fail("can't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+    }
+
+    void check(const juce::ArgumentList& args)
+    {
+        RegressionCheckOptions options;
+        options.goldenDirectory = args.getFileForOption("--golden");
+        options.record = args.containsOption("--record");
+        options.quick = args.containsOption("--quick");
+
+        if (! options.record && ! options.goldenDirectory.isDirectory())
+            juce::ConsoleApplication::fail("no golden files in " + options.goldenDirectory.getFullPathName() + ", record them with --record");
+
+        if (! AllocationCounter::isEnabled)
+            std::cerr << "built without MARS_COUNT_ALLOCATIONS, allocations on the audio thread aren't checked" << std::endl;
+
+        int numFailed = 0;
+
+        const auto components = RegressionCheck::runComponentChecks();
+
+        for (const auto& component : components)
+        {
+            std::cout << component.name << "  " << juce::String(component.errorDb, 1) << " dB  "
+                      << (component.passed() ? "ok" : "FAILED") << std::endl;
+
+            if (! component.passed())
+                ++numFailed;
+        }
+
+        const auto results = RegressionCheck(options).run([&numFailed](const RegressionCheck::Result& result)
+        {
+            std::cout << result.name << "  golden " << juce::String(result.goldenErrorDb, 1) << " dB  blocks "
+                      << juce::String(result.blockErrorDb, 1) << " dB  "
+                      << juce::String(result.nsPerSample, 1) << " ns/sample  "
+                      << (result.allocatingBlocks > 0 ? juce::String(result.allocatingBlocks) + " allocating blocks  " : juce::String())
+                      << (result.passed() ? "ok" : "FAILED") << std::endl;
+
+            if (result.error.isNotEmpty())
+                std::cerr << result.name << ": " << result.error << std::endl;
+
+            if (! result.passed())
+                ++numFailed;
+        });
+
+        if (args.containsOption("--out"))
+        {
+            const auto file = args.getFileForOption("--out");
+
+            if (! file.replaceWithText(juce::JSON::toString(RegressionCheck::toJSON(components, results))))
+                juce::ConsoleApplication::fail("can't write " + file.getFullPathName());
+        }
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail(juce::String(numFailed) + " of " + juce::String(components.size() + results.size()) + " cases failed");
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // the processor starts a Timer and foleys builds its GUI state, both want a message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h", "Usage: MarsRender --render [options] files...", true);
+
+    app.addCommand({ "--render",
+                     "--render [--out=dir] [--preset=file.xml] [--format=wav|flac] [--jobs=n] [--block=n] [--tail=seconds|auto] files...",
+                     "Renders each file through the mars chain into the output folder.",
+                     "Options take the form --name=value. The preset is an apvts state saved as XML, "
+                     "files are processed in chunks of --block samples, --jobs at a time. --tail=auto renders "
+                     "the tail length the chain reports for the preset.",
+                     render });
+
+    app.addCommand({ "--bench",
+                     "--bench [--out=results.json] [--quick] [--seconds=s]",
+                     "Measures processBlock and each chain stage and writes the results as JSON.",
+                     "Sweeps block sizes 16 to 4096, sample rates 44.1 to 192 kHz and the default, minimum and "
+                     "maximum value of every parameter. --quick only runs a few sizes at 48 kHz.",
+                     benchmark });
+
+    app.addCommand({ "--check",
+                     "--check --golden=dir [--record] [--quick] [--out=report.json]",
+                     "Renders fixed stimuli and compares them against golden files, failing on any difference.",
+                     "Impulse, sweep, noise bursts and silence go through the defaults, the minimum and maximum of "
+                     "every parameter, both reverbs on Convolution with a generated impulse response in realtime and "
+                     "offline, and each parameter on its own at both ends of its range. Every case must match "
+                     "its golden file and render the same in 1 sample blocks as in 4096 sample blocks, each within "
+                     "its own threshold. --record writes the golden files from this build instead, refusing renders "
+                     "that aren't finite. --quick skips the single parameter sets and uses 1 second stimuli, so it "
+                     "needs golden files of its own, see Golden/Quick. The time per sample is reported with each case.",
+                     check });
+
+    return app.findAndRunCommand(argc, argv);
+}
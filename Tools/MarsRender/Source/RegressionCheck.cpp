@@ -0,0 +1,486 @@
+/*
+  ==============================================================================
+
+    RegressionCheck.cpp
+
+  ==============================================================================
+*/
+
+#include "RegressionCheck.h"
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/FreeverbCore.h"
+#include "../../../Source/CascadedFilter.h"
+
+namespace
+{
+    using Stimulus = RegressionCheck::Stimulus;
+
+    // how long a render waits for the convolution slots to load the generated impulse response
+    constexpr int impulseResponseWaitMs = 10000;
+
+    struct ParameterSet
+    {
+        juce::String name;
+        std::array<float, numParameters> values;
+
+        // both slots load the generated impulse response, rendered with the host in realtime or offline
+        bool convolution = false, nonRealtime = false;
+    };
+
+    /** The defaults, every parameter at its minimum and at its maximum, both
+        reverbs on Convolution in realtime and offline, and unless quick, each
+        parameter on its own at both ends of its range with the rest at their
+        defaults.
+    */
+    juce::Array<ParameterSet> getParameterSets(bool quick)
+    {
+        ParameterSet defaults{ "defaults", {} }, minimum{ "minimum", {} }, maximum{ "maximum", {} };
+
+        for (const auto& spec : parameterSpecs)
+        {
+            defaults.values[(size_t)spec.parameter] = spec.defaultValue;
+            minimum.values[(size_t)spec.parameter] = spec.minValue;
+            maximum.values[(size_t)spec.parameter] = spec.maxValue;
+        }
+
+        auto convolution = defaults;
+        convolution.name = "convolution";
+        convolution.values[(size_t)ParameterId::reverb1Algorithm] = (float)ReverbAlgorithm::convolution;
+        convolution.values[(size_t)ParameterId::reverb2Algorithm] = (float)ReverbAlgorithm::convolution;
+        convolution.convolution = true;
+
+        auto convolutionOffline = convolution;
+        convolutionOffline.name = "convolutionOffline";
+        convolutionOffline.nonRealtime = true;
+
+        juce::Array<ParameterSet> sets{ defaults, minimum, maximum, convolution, convolutionOffline };
+
+        if (quick)
+            return sets;
+
+        auto addSet = [&](const ParameterSpec& spec, const char* suffix, float value)
+        {
+            // already covered by the defaults
+            if (juce::approximatelyEqual(value, spec.defaultValue))
+                return;
+
+            auto set = defaults;
+            set.name = juce::String(spec.id) + suffix;
+            set.values[(size_t)spec.parameter] = value;
+            sets.add(set);
+        };
+
+        for (const auto& spec : parameterSpecs)
+        {
+            addSet(spec, "Min", spec.minValue);
+            addSet(spec, "Max", spec.maxValue);
+        }
+
+        return sets;
+    }
+
+    // golden and block size thresholds in dBFS, noise and sweeps leave room for other compilers' rounding
+    std::pair<double, double> getThresholds(Stimulus stimulus)
+    {
+        switch (stimulus)
+        {
+            case Stimulus::impulse:     return { -90.0, -100.0 };
+            case Stimulus::sweep:       return { -80.0, -100.0 };
+            case Stimulus::noiseBursts: return { -80.0, -100.0 };
+            case Stimulus::silence:     break;
+        }
+
+        // nothing in, nothing out, whatever the block size
+        return { -120.0, -120.0 };
+    }
+
+    // the stimulus takes the first half, the second half is left for the tail
+    juce::AudioBuffer<float> createStimulus(Stimulus stimulus, double sampleRate, double seconds)
+    {
+        const auto numSamples = (int)std::ceil(sampleRate * seconds);
+        const auto activeSamples = numSamples / 2;
+
+        juce::AudioBuffer<float> buffer(2, numSamples);
+        buffer.clear();
+
+        switch (stimulus)
+        {
+            case Stimulus::impulse:
+            {
+                // a little into the buffer, so a chain that looks ahead would show it
+                const auto position = (int)(0.01 * sampleRate);
+                buffer.setSample(0, position, 1.0f);
+                buffer.setSample(1, position, 1.0f);
+                break;
+            }
+
+            case Stimulus::sweep:
+            {
+                // exponential 20 Hz to 20 kHz at -6 dBFS
+                const auto lowest = 20.0, highest = 20000.0;
+                const auto length = activeSamples / sampleRate;
+                const auto k = std::log(highest / lowest);
+
+                for (int i = 0; i < activeSamples; ++i)
+                {
+                    const auto t = i / sampleRate;
+                    const auto phase = juce::MathConstants<double>::twoPi * lowest * length / k * (std::exp(t * k / length) - 1.0);
+                    const auto sample = 0.5f * (float)std::sin(phase);
+
+                    buffer.setSample(0, i, sample);
+                    buffer.setSample(1, i, sample);
+                }
+
+                break;
+            }
+
+            case Stimulus::noiseBursts:
+            {
+                // 50 ms of uncorrelated noise every 250 ms
+                juce::Random random(1);
+                const auto period = (int)(0.25 * sampleRate), burst = (int)(0.05 * sampleRate);
+
+                for (int start = 0; start < activeSamples; start += period)
+                    for (int ch = 0; ch < 2; ++ch)
+                        for (int i = start; i < juce::jmin(start + burst, activeSamples); ++i)
+                            buffer.setSample(ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+                break;
+            }
+
+            case Stimulus::silence:
+                break;
+        }
+
+        return buffer;
+    }
+
+    // a quarter second of decaying stereo noise, long enough to reach the convolver's background tail
+    juce::AudioBuffer<float> createImpulseResponse(double sampleRate)
+    {
+        const auto numSamples = (int)(0.25 * sampleRate);
+
+        juce::AudioBuffer<float> buffer(2, numSamples);
+        juce::Random random(2);
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample(ch, i, (random.nextFloat() * 2.0f - 1.0f) * std::pow(0.001f, (float)i / (float)numSamples));
+
+        return buffer;
+    }
+
+    /** Renders input through a processor prepared for options.blockSize, fed in
+        chunks of renderBlockSize. Adds the time spent in processBlock to ticks
+        and the blocks that hit the heap to allocatingBlocks, and sets error if
+        the impulse response of a convolution set didn't load.
+    */
+    juce::AudioBuffer<float> render(const ParameterSet& set, const juce::AudioBuffer<float>& input,
+                                    const RegressionCheckOptions& options, const juce::File& impulseResponse,
+                                    int renderBlockSize, juce::int64& ticks, juce::uint64& allocatingBlocks,
+                                    juce::String& error)
+    {
+        MarsAudioProcessor processor;
+
+        for (const auto& spec : parameterSpecs)
+        {
+            auto* parameter = processor.apvts.getParameter(spec.id);
+            jassert(parameter != nullptr);
+
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(set.values[(size_t)spec.parameter]));
+        }
+
+        // before prepareToPlay, the way a host restores a session
+        if (set.convolution)
+            for (int slot = 0; slot < 2; ++slot)
+                processor.loadImpulseResponse(slot, impulseResponse);
+
+        processor.setNonRealtime(set.nonRealtime);
+        processor.setPlayConfigDetails(2, 2, options.sampleRate, options.blockSize);
+        processor.prepareToPlay(options.sampleRate, options.blockSize);
+
+        // it is rebuilt at the new rate in the background, a render that started before that would depend on timing
+        if (set.convolution && (! processor.waitForImpulseResponses(impulseResponseWaitMs)
+                                || processor.getImpulseResponseFile(0) != impulseResponse
+                                || processor.getImpulseResponseFile(1) != impulseResponse))
+            error = "the impulse response didn't load: " + impulseResponse.getFullPathName();
+
+        juce::AudioBuffer<float> output;
+        output.makeCopyOf(input, true);
+
+        juce::MidiBuffer midi;
+
+        // processBlock's ScopedAllocationCheck counts every block that allocated
+        AllocationCounter::resetViolations();
+
+        for (int position = 0; position < output.getNumSamples();)
+        {
+            const auto numSamples = juce::jmin(renderBlockSize, output.getNumSamples() - position);
+
+            // processed in place, straight in the output
+            juce::AudioBuffer<float> block(output.getArrayOfWritePointers(), output.getNumChannels(), position, numSamples);
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock(block, midi);
+            ticks += juce::Time::getHighResolutionTicks() - start;
+
+            position += numSamples;
+        }
+
+        allocatingBlocks += AllocationCounter::getNumViolations();
+
+        processor.releaseResources();
+        return output;
+    }
+
+    bool isFinite(const juce::AudioBuffer<float>& buffer)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                if (! std::isfinite(buffer.getSample(ch, i)))
+                    return false;
+
+        return true;
+    }
+
+    double getPeakDifferenceDb(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        jassert(a.getNumChannels() == b.getNumChannels() && a.getNumSamples() == b.getNumSamples());
+
+        // NaN never compares larger, so a broken buffer on either side is failed here
+        if (! isFinite(a) || ! isFinite(b))
+            return 0.0;
+
+        float peak = 0.0f;
+
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+        {
+            const auto* x = a.getReadPointer(ch);
+            const auto* y = b.getReadPointer(ch);
+
+            for (int i = 0; i < a.getNumSamples(); ++i)
+                peak = juce::jmax(peak, std::abs(x[i] - y[i]));
+        }
+
+        return juce::Decibels::gainToDecibels((double)peak, RegressionCheck::floorDb);
+    }
+
+    bool readGolden(const juce::File& file, double sampleRate, juce::AudioBuffer<float>& golden, juce::String& error)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader;
+
+        if (file.existsAsFile())
+            reader.reset(juce::WavAudioFormat().createReaderFor(file.createInputStream().release(), true));
+
+        if (reader == nullptr)
+        {
+            error = "no golden file " + file.getFullPathName() + ", record one with --record";
+            return false;
+        }
+
+        if (! juce::approximatelyEqual(reader->sampleRate, sampleRate) || reader->numChannels != (unsigned int)golden.getNumChannels()
+            || reader->lengthInSamples != (juce::int64)golden.getNumSamples())
+        {
+            error = "golden file doesn't match the stimulus: " + file.getFullPathName();
+            return false;
+        }
+
+        reader->read(&golden, 0, golden.getNumSamples(), 0, true, true);
+        return true;
+    }
+
+    // golden files and the generated impulse response
+    bool writeWav(const juce::File& file, double sampleRate, const juce::AudioBuffer<float>& output, juce::String& error)
+    {
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+
+        // 32 bit float, so the file holds exactly what was rendered
+        if (stream != nullptr)
+            writer.reset(juce::WavAudioFormat().createWriterFor(stream.get(), sampleRate, (unsigned int)output.getNumChannels(), 32, {}, 0));
+
+        if (writer == nullptr)
+        {
+            error = "can't write " + file.getFullPathName();
+            return false;
+        }
+
+        stream.release(); // the writer owns it now
+
+        if (! writer->writeFromAudioSampleBuffer(output, 0, output.getNumSamples()))
+        {
+            error = "write failed: " + file.getFullPathName();
+            return false;
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+RegressionCheck::RegressionCheck(RegressionCheckOptions newOptions)
+    : options(std::move(newOptions))
+{
+    options.blockSize = juce::jmax(1, options.blockSize);
+    options.smallBlockSize = juce::jlimit(1, options.blockSize, options.smallBlockSize);
+}
+
+juce::String RegressionCheck::getStimulusName(Stimulus stimulus)
+{
+    switch (stimulus)
+    {
+        case Stimulus::sweep:       return "sweep";
+        case Stimulus::noiseBursts: return "noiseBursts";
+        case Stimulus::silence:     return "silence";
+        case Stimulus::impulse:     break;
+    }
+
+    return "impulse";
+}
+
+juce::Array<RegressionCheck::ComponentResult> RegressionCheck::runComponentChecks()
+{
+    juce::Array<ComponentResult> results;
+
+    // only the kernels this build and CPU can run, selectKernel falls back to scalar otherwise
+    for (auto kernel : { FreeverbCore::Kernel::simd, FreeverbCore::Kernel::avx })
+    {
+        FreeverbCore core;
+        core.selectKernel(kernel);
+
+        if (core.getKernel() != kernel || (kernel == FreeverbCore::Kernel::avx && FreeverbCore::getBestKernel() != kernel))
+            continue;
+
+        ComponentResult result;
+        result.name = kernel == FreeverbCore::Kernel::avx ? "freeverbKernelAVX" : "freeverbKernelSIMD";
+        result.errorDb = juce::Decibels::gainToDecibels((double)FreeverbCore::runNullTest(kernel), floorDb);
+        result.thresholdDb = -100.0;
+        results.add(result);
+    }
+
+    for (auto type : { CascadedFilter::Type::lowPass, CascadedFilter::Type::highPass })
+    {
+        ComponentResult result;
+        result.name = type == CascadedFilter::Type::lowPass ? "cascadedFilterLowPass12" : "cascadedFilterHighPass12";
+        result.errorDb = juce::Decibels::gainToDecibels((double)CascadedFilter::runBiquadComparison(type), floorDb);
+        result.thresholdDb = -100.0;
+        results.add(result);
+    }
+
+    return results;
+}
+
+juce::Array<RegressionCheck::Result> RegressionCheck::run(std::function<void(const Result&)> onResult) const
+{
+    juce::Array<Result> results;
+
+    if (options.record)
+        options.goldenDirectory.createDirectory();
+
+    // the same impulse response every run, written at the check's rate
+    const juce::TemporaryFile impulseResponse(".wav");
+    juce::String impulseResponseError;
+
+    writeWav(impulseResponse.getFile(), options.sampleRate, createImpulseResponse(options.sampleRate), impulseResponseError);
+
+    const auto stimulusSeconds = options.quick ? options.quickStimulusSeconds : options.stimulusSeconds;
+
+    for (auto stimulus : { Stimulus::impulse, Stimulus::sweep, Stimulus::noiseBursts, Stimulus::silence })
+    {
+        const auto input = createStimulus(stimulus, options.sampleRate, stimulusSeconds);
+        const auto numSamples = (double)input.getNumSamples();
+
+        for (const auto& set : getParameterSets(options.quick))
+        {
+            Result result;
+            result.name = getStimulusName(stimulus) + "_" + set.name;
+            result.stimulus = stimulus;
+            std::tie(result.goldenThresholdDb, result.blockThresholdDb) = getThresholds(stimulus);
+
+            juce::int64 ticks = 0, smallBlockTicks = 0;
+            const auto output = render(set, input, options, impulseResponse.getFile(), options.blockSize,
+                                       ticks, result.allocatingBlocks, result.error);
+            const auto smallBlockOutput = render(set, input, options, impulseResponse.getFile(), options.smallBlockSize,
+                                                 smallBlockTicks, result.allocatingBlocks, result.error);
+
+            // the reason the impulse response didn't load
+            if (set.convolution && impulseResponseError.isNotEmpty())
+                result.error = impulseResponseError;
+
+            result.nsPerSample = juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9 / numSamples;
+            result.smallBlockNsPerSample = juce::Time::highResolutionTicksToSeconds(smallBlockTicks) * 1.0e9 / numSamples;
+            result.blockErrorDb = getPeakDifferenceDb(smallBlockOutput, output);
+
+            const auto goldenFile = options.goldenDirectory.getChildFile(result.name + ".wav");
+
+            // a render without its impulse response is neither recorded nor compared
+            if (options.record && result.error.isEmpty())
+            {
+                // a broken build must never become the reference
+                if (! isFinite(output) || ! isFinite(smallBlockOutput))
+                    result.error = "the render isn't finite, not recorded";
+                else
+                    writeWav(goldenFile, options.sampleRate, output, result.error);
+            }
+            else if (result.error.isEmpty())
+            {
+                juce::AudioBuffer<float> golden(output.getNumChannels(), output.getNumSamples());
+
+                if (readGolden(goldenFile, options.sampleRate, golden, result.error))
+                    result.goldenErrorDb = getPeakDifferenceDb(output, golden);
+            }
+
+            results.add(result);
+
+            if (onResult)
+                onResult(result);
+        }
+    }
+
+    return results;
+}
+
+juce::var RegressionCheck::toJSON(const juce::Array<ComponentResult>& components, const juce::Array<Result>& results)
+{
+    juce::Array<juce::var> componentEntries, entries;
+
+    for (const auto& component : components)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("name", component.name);
+        entry->setProperty("passed", component.passed());
+        entry->setProperty("errorDb", component.errorDb);
+        entry->setProperty("thresholdDb", component.thresholdDb);
+        componentEntries.add(juce::var(entry));
+    }
+
+    for (const auto& result : results)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("name", result.name);
+        entry->setProperty("stimulus", getStimulusName(result.stimulus));
+        entry->setProperty("passed", result.passed());
+        entry->setProperty("goldenErrorDb", result.goldenErrorDb);
+        entry->setProperty("goldenThresholdDb", result.goldenThresholdDb);
+        entry->setProperty("blockErrorDb", result.blockErrorDb);
+        entry->setProperty("blockThresholdDb", result.blockThresholdDb);
+        entry->setProperty("nsPerSample", result.nsPerSample);
+        entry->setProperty("smallBlockNsPerSample", result.smallBlockNsPerSample);
+        entry->setProperty("allocatingBlocks", (juce::int64)result.allocatingBlocks);
+
+        if (result.error.isNotEmpty())
+            entry->setProperty("error", result.error);
+
+        entries.add(juce::var(entry));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+    root->setProperty("components", componentEntries);
+    root->setProperty("results", entries);
+
+    return juce::var(root);
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    RegressionCheck.h
+
+    Renders fixed stimuli through MarsAudioProcessor with parameter sets
+    covering the range of every parameter and compares the output against
+    golden files recorded from a trusted build. Each case is also rendered
+    in tiny blocks to check that the output doesn't depend on the host's
+    buffer size. The Convolution cases load a generated impulse response
+    before prepareToPlay, the way a host restores a session, and render it
+    both in realtime and offline. The time processBlock took is reported next to the
+    errors, so an optimisation comes with its proof that nothing changed.
+    Built with MARS_COUNT_ALLOCATIONS, a processBlock that allocates fails
+    its case as well.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct RegressionCheckOptions
+{
+    juce::File goldenDirectory;
+    bool record = false;             // writes the golden files instead of comparing against them
+    bool quick = false;              // only the default, minimum, maximum and convolution sets, on shorter stimuli
+
+    double sampleRate = 48000.0;
+    double stimulusSeconds = 2.0, quickStimulusSeconds = 1.0;
+
+    // the chain is prepared for blockSize and rendered once in blocks of that size, once in smallBlockSize
+    int blockSize = 4096;
+    int smallBlockSize = 1;
+};
+
+class RegressionCheck
+{
+public:
+    enum class Stimulus
+    {
+        impulse,
+        sweep,
+        noiseBursts,
+        silence
+    };
+
+    struct Result
+    {
+        juce::String name;               // stimulus and parameter set, also the golden file's name
+        Stimulus stimulus;
+
+        // peak sample difference in dBFS, to the golden file and between the two block sizes
+        double goldenErrorDb = floorDb;
+        double blockErrorDb = floorDb;
+        double goldenThresholdDb = 0.0, blockThresholdDb = 0.0;
+
+        double nsPerSample = 0.0;        // processBlock in blockSize blocks, per sample frame
+        double smallBlockNsPerSample = 0.0;
+
+        // processBlock calls that hit the heap, only counted in builds with MARS_COUNT_ALLOCATIONS
+        juce::uint64 allocatingBlocks = 0;
+
+        juce::String error;              // the golden file is missing or doesn't match the render
+
+        bool passed() const noexcept
+        {
+            return error.isEmpty() && allocatingBlocks == 0
+                && goldenErrorDb <= goldenThresholdDb && blockErrorDb <= blockThresholdDb;
+        }
+    };
+
+    // an optimised DSP building block measured against its plain reference
+    struct ComponentResult
+    {
+        juce::String name;
+        double errorDb = floorDb;        // peak difference in dBFS
+        double thresholdDb = 0.0;
+
+        bool passed() const noexcept { return errorDb <= thresholdDb; }
+    };
+
+    // what identical output reads as
+    static constexpr double floorDb = -200.0;
+
+    explicit RegressionCheck(RegressionCheckOptions options);
+
+    /** Renders and checks every case, calling onResult after each one. The full
+        set renders every stimulus about a hundred times, the tiny blocks make
+        up most of that.
+    */
+    juce::Array<Result> run(std::function<void(const Result&)> onResult = {}) const;
+
+    // the kernel null tests and the filter's biquad comparison, they need no golden files
+    static juce::Array<ComponentResult> runComponentChecks();
+
+    static juce::String getStimulusName(Stimulus stimulus);
+    static juce::var toJSON(const juce::Array<ComponentResult>& components, const juce::Array<Result>& results);
+
+private:
+    RegressionCheckOptions options;
+};
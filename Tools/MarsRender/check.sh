@@ -0,0 +1,38 @@
+#!/bin/sh
+# Exports the Linux makefile for MarsRender.jucer with the Projucer, builds its
+# Debug configuration, which counts allocations on the audio thread, and runs
+# the quick regression check against the golden files in Golden/Quick. Exits
+# non-zero if a case fails or there are no golden files, so CI can run it as it is.
+#
+#   PROJUCER      the Projucer to export with, if it isn't on the PATH
+#   JUCE_MODULES  the JUCE modules folder, if the Projucer's global path isn't set
+#   --record      writes Golden/Quick from this build instead, commit what it writes
+
+set -e
+cd "$(dirname "$0")"
+
+projucer="${PROJUCER:-Projucer}"
+
+if ! command -v "$projucer" >/dev/null 2>&1; then
+    echo "check.sh: no Projucer, put it on the PATH or set PROJUCER" >&2
+    exit 1
+fi
+
+if [ -n "$JUCE_MODULES" ]; then
+    "$projucer" --set-global-search-path linux defaultJuceModulePath "$JUCE_MODULES"
+fi
+
+"$projucer" --resave MarsRender.jucer
+make -C Builds/LinuxMakefile CONFIG=Debug -j"$(nproc)"
+
+if [ "$1" = "--record" ]; then
+    shift
+    exec Builds/LinuxMakefile/build/MarsRender --check --quick --record --golden=Golden/Quick "$@"
+fi
+
+if ! ls Golden/Quick/*.wav >/dev/null 2>&1; then
+    echo "check.sh: no golden files in Golden/Quick, record them with check.sh --record and commit them" >&2
+    exit 1
+fi
+
+exec Builds/LinuxMakefile/build/MarsRender --check --quick --golden=Golden/Quick --out=check-report.json "$@"